@@ -0,0 +1,345 @@
+#ifndef LMS_ANALYTICS_H
+#define LMS_ANALYTICS_H
+
+#include <array>
+#include <set>
+#include <unordered_map>
+
+#include "ledger.h"
+
+// ==================== Borrow Analytics ====================>
+
+// Sliding-window borrow counts per ISBN for "most borrowed this month" and "trending this week".
+//
+// Borrows are counted in one Count-Min sketch per day over the last WINDOW_DAYS days, so memory
+// does not grow with the catalog. Each report keeps a bounded candidate set (a heavy-hitters table
+// ordered by score) that is updated on every borrow, so a top-N query reads the first N entries
+// without scanning the catalog. Expired days are cleared when the clock moves on and the candidates
+// are re-scored.
+class BorrowAnalytics {
+public:
+    static constexpr int WINDOW_DAYS = 30;
+    static constexpr int WEEK_DAYS = 7;
+
+private:
+    static constexpr size_t DEPTH = 4;
+    static constexpr size_t WIDTH = 4096;
+    static constexpr size_t CANDIDATES = 256;
+
+    using Sketch = array<array<uint32_t, WIDTH>, DEPTH>;
+
+    // Candidates ordered by score, with the score of each ISBN
+    struct Ranking {
+        set<pair<double, string>, greater<>> ordered;
+        unordered_map<string, double> scores;
+
+        void update(const string &isbn, double score) {
+            auto it = scores.find(isbn);
+            if (it != scores.end()) {
+                ordered.erase({it->second, isbn});
+                it->second = score;
+                ordered.insert({score, isbn});
+                return;
+            }
+
+            if (scores.size() == CANDIDATES) {
+                auto weakest = prev(ordered.end());
+                if (weakest->first >= score) { return; }
+                scores.erase(weakest->second);
+                ordered.erase(weakest);
+            }
+            scores.emplace(isbn, score);
+            ordered.insert({score, isbn});
+        }
+
+        vector<pair<string, double>> top(size_t n) const {
+            vector<pair<string, double>> result;
+            for (auto it = ordered.begin(); it != ordered.end() && result.size() < n; ++it) {
+                result.emplace_back(it->second, it->first);
+            }
+            return result;
+        }
+    };
+
+    vector<Sketch> days = vector<Sketch>(WINDOW_DAYS);
+    int64_t current_day = -1;
+    Ranking most_borrowed;
+    Ranking trending;
+
+    static size_t column(uint64_t hash, size_t row) {
+        uint64_t h1 = hash, h2 = (hash >> 32) | 1;
+        return (h1 + row * h2) % WIDTH;
+    }
+
+    // Estimated borrows of an ISBN over the last `count` days
+    uint32_t estimate(uint64_t hash, int count) const {
+        uint32_t total = 0;
+        for (int d = 0; d < count; ++d) {
+            const Sketch &sketch = days[size_t(current_day - d) % WINDOW_DAYS];
+            uint32_t day_min = UINT32_MAX;
+            for (size_t row = 0; row < DEPTH; ++row) {
+                day_min = min(day_min, sketch[row][column(hash, row)]);
+            }
+            total += day_min;
+        }
+        return total;
+    }
+
+    // Growth of this week over the daily rate of the rest of the window
+    double trendScore(uint64_t hash) const {
+        double week = estimate(hash, WEEK_DAYS);
+        double earlier = estimate(hash, WINDOW_DAYS) - week;
+        return week - earlier * WEEK_DAYS / (WINDOW_DAYS - WEEK_DAYS);
+    }
+
+    void rescore(const string &isbn) {
+        uint64_t hash = fnv1a(isbn);
+        most_borrowed.update(isbn, estimate(hash, WINDOW_DAYS));
+        trending.update(isbn, trendScore(hash));
+    }
+
+    // Move the window forward, clearing days that fell out of it
+    void advanceTo(int64_t day) {
+        if (current_day >= 0 && day <= current_day) { return; }
+
+        int64_t cleared = current_day < 0 ? WINDOW_DAYS : min<int64_t>(day - current_day, WINDOW_DAYS);
+        for (int64_t d = 0; d < cleared; ++d) {
+            days[size_t(day - d) % WINDOW_DAYS] = Sketch{};
+        }
+        current_day = day;
+
+        // Re-score the candidates against the new window
+        vector<string> candidates;
+        for (const auto &[isbn, score]: most_borrowed.scores) {
+            candidates.push_back(isbn);
+        }
+        for (const auto &[isbn, score]: trending.scores) {
+            candidates.push_back(isbn);
+        }
+        most_borrowed = Ranking();
+        trending = Ranking();
+        for (const auto &isbn: candidates) {
+            rescore(isbn);
+        }
+    }
+
+public:
+    // Count a borrow at the given time
+    void recordBorrow(const string &isbn, time_t time) {
+        int64_t day = time / (24 * 60 * 60);
+        advanceTo(day);
+        if (day <= current_day - WINDOW_DAYS) { return; }
+
+        uint64_t hash = fnv1a(isbn);
+        Sketch &sketch = days[size_t(day) % WINDOW_DAYS];
+        for (size_t row = 0; row < DEPTH; ++row) {
+            ++sketch[row][column(hash, row)];
+        }
+        rescore(isbn);
+    }
+
+    void recordBorrow(const Mutation &mutation) {
+        if (mutation.type == Mutation::BORROW) { recordBorrow(mutation.isbn, mutation.commit_ms / 1000); }
+    }
+
+    // Most borrowed ISBNs over the last WINDOW_DAYS days, with estimated borrow counts
+    vector<pair<string, double>> topBorrowed(size_t n) {
+        advanceTo(time(nullptr) / (24 * 60 * 60));
+        return most_borrowed.top(n);
+    }
+
+    // ISBNs borrowed most above their usual rate this week
+    vector<pair<string, double>> topTrending(size_t n) {
+        advanceTo(time(nullptr) / (24 * 60 * 60));
+        vector<pair<string, double>> result = trending.top(n);
+        while (!result.empty() && result.back().second <= 0) { result.pop_back(); }
+        return result;
+    }
+};
+
+// ==================== Recommendations ====================>
+
+// "Patrons who borrowed X also borrowed Y".
+//
+// A sparse co-occurrence matrix counts, for every pair of books, the patrons who borrowed both.
+// Each borrow of a book new to the patron's history adds the pairs with the books already in it.
+// Top-k neighbours are precomputed per book and recomputed only for rows a borrow touched.
+class RecommendationEngine {
+    static constexpr size_t HISTORY_LIMIT = 50; // most recent distinct books kept per patron
+    static constexpr size_t TOP_K = 10;
+
+    struct Row {
+        unordered_map<uint32_t, uint32_t> counts;
+        vector<pair<uint32_t, uint32_t>> top; // (book, count), best first
+        bool dirty = false;
+    };
+
+    vector<string> book_keys;
+    unordered_map<string, uint32_t> book_ids;
+    unordered_map<string, uint32_t> patron_ids;
+    vector<vector<uint32_t>> histories;
+    vector<Row> rows;
+
+    uint32_t bookId(const string &isbn) {
+        auto [it, inserted] = book_ids.emplace(isbn, uint32_t(book_keys.size()));
+        if (inserted) {
+            book_keys.push_back(isbn);
+            rows.emplace_back();
+        }
+        return it->second;
+    }
+
+    uint32_t patronId(const string &patron) {
+        auto [it, inserted] = patron_ids.emplace(patron, uint32_t(histories.size()));
+        if (inserted) { histories.emplace_back(); }
+        return it->second;
+    }
+
+    // Add a book to a patron's history; returns false if it was already there
+    static bool addToHistory(vector<uint32_t> &history, uint32_t book) {
+        if (find(history.begin(), history.end(), book) != history.end()) { return false; }
+        if (history.size() == HISTORY_LIMIT) { history.erase(history.begin()); }
+        history.push_back(book);
+        return true;
+    }
+
+    static void computeTop(Row &row) {
+        row.top.assign(row.counts.begin(), row.counts.end());
+        size_t k = min(TOP_K, row.top.size());
+        partial_sort(row.top.begin(), row.top.begin() + k, row.top.end(), [](const auto &a, const auto &b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        row.top.resize(k);
+        row.dirty = false;
+    }
+
+public:
+    // Count a borrow of isbn by the patron identified by name|mobile|email
+    void recordBorrow(const string &patron, const string &isbn) {
+        uint32_t book = bookId(isbn);
+        vector<uint32_t> &history = histories[patronId(patron)];
+        if (find(history.begin(), history.end(), book) != history.end()) { return; }
+
+        for (uint32_t other: history) {
+            ++rows[book].counts[other];
+            ++rows[other].counts[book];
+            rows[other].dirty = true;
+        }
+        rows[book].dirty = true;
+        addToHistory(history, book);
+    }
+
+    void recordBorrow(const Mutation &mutation) {
+        if (mutation.type != Mutation::BORROW) { return; }
+        Borrower borrower = Borrower::fromString(mutation.payload);
+        recordBorrow(borrower.getName() + "|" + borrower.getMobile() + "|" + borrower.getEmail(), mutation.isbn);
+    }
+
+    // Recompute the matrix from (patron, isbn) borrows in order. Patron histories are replayed
+    // first; then each thread fills the rows of the books it owns (book id modulo thread count)
+    // and computes their top-k, so no row is shared between threads.
+    void rebuild(const vector<pair<string, string>> &borrows, unsigned thread_count) {
+        TraceSpan span("recommendations.rebuild");
+        book_keys.clear();
+        book_ids.clear();
+        patron_ids.clear();
+        histories.clear();
+        rows.clear();
+
+        // Co-borrowed pairs come from each patron's distinct books, in history order
+        vector<vector<uint32_t>> pair_sources;
+        for (const auto &[patron, isbn]: borrows) {
+            uint32_t book = bookId(isbn);
+            uint32_t patron_id = patronId(patron);
+            if (pair_sources.size() <= patron_id) { pair_sources.resize(patron_id + 1); }
+
+            vector<uint32_t> &history = histories[patron_id];
+            if (find(history.begin(), history.end(), book) != history.end()) { continue; }
+            pair_sources[patron_id].push_back(book);
+            addToHistory(history, book);
+        }
+
+        thread_count = max(1u, thread_count);
+        auto fillRows = [&](unsigned owner) {
+            // Collect the owned pairs as (row << 32 | column) keys and count equal runs after sorting,
+            // which is far cheaper than hashing every pair occurrence
+            vector<uint64_t> keys;
+            for (const auto &books: pair_sources) {
+                // Pair each book with the HISTORY_LIMIT books borrowed before it, as recordBorrow does
+                for (size_t i = 0; i < books.size(); ++i) {
+                    for (size_t j = i > HISTORY_LIMIT ? i - HISTORY_LIMIT : 0; j < i; ++j) {
+                        if (books[i] % thread_count == owner) { keys.push_back(uint64_t(books[i]) << 32 | books[j]); }
+                        if (books[j] % thread_count == owner) { keys.push_back(uint64_t(books[j]) << 32 | books[i]); }
+                    }
+                }
+            }
+            sort(keys.begin(), keys.end());
+
+            for (size_t i = 0; i < keys.size();) {
+                uint32_t book = uint32_t(keys[i] >> 32);
+                size_t row_end = i;
+                size_t distinct = 0;
+                for (; row_end < keys.size() && uint32_t(keys[row_end] >> 32) == book; ++row_end) {
+                    distinct += row_end == i || keys[row_end] != keys[row_end - 1];
+                }
+
+                Row &row = rows[book];
+                row.counts.reserve(distinct);
+                while (i < row_end) {
+                    size_t run = i;
+                    while (run < row_end && keys[run] == keys[i]) { ++run; }
+                    row.counts.emplace(uint32_t(keys[i]), uint32_t(run - i));
+                    i = run;
+                }
+            }
+
+            for (size_t book = owner; book < rows.size(); book += thread_count) {
+                computeTop(rows[book]);
+            }
+        };
+
+        vector<thread> workers;
+        for (unsigned t = 1; t < thread_count; ++t) {
+            workers.emplace_back(fillRows, t);
+        }
+        fillRows(0);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    // Rebuild from every borrow in the loan ledger
+    void rebuild(const LoanLedger &ledger, unsigned thread_count) {
+        vector<pair<string, string>> borrows;
+        ledger.scanTimeRange(INT64_MIN, INT64_MAX, [&](const LoanEvent &event) {
+            if (event.type == LoanEvent::BORROW) {
+                borrows.emplace_back(ledger.patronKey(event.patron_id), ledger.bookKey(event.book_id));
+            }
+        });
+        rebuild(borrows, thread_count);
+    }
+
+    // Books most often co-borrowed with isbn, with the number of shared patrons
+    vector<pair<string, uint32_t>> recommend(const string &isbn, size_t k = TOP_K) {
+        vector<pair<string, uint32_t>> result;
+        auto it = book_ids.find(isbn);
+        if (it == book_ids.end()) { return result; }
+
+        Row &row = rows[it->second];
+        if (row.dirty) { computeTop(row); }
+        for (size_t i = 0; i < row.top.size() && i < k; ++i) {
+            result.emplace_back(book_keys[row.top[i].first], row.top[i].second);
+        }
+        return result;
+    }
+
+    size_t pairCount() const {
+        size_t count = 0;
+        for (const auto &row: rows) {
+            count += row.counts.size();
+        }
+        return count;
+    }
+};
+
+#endif //LMS_ANALYTICS_H
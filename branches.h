@@ -0,0 +1,131 @@
+#ifndef LMS_BRANCHES_H
+#define LMS_BRANCHES_H
+
+#include <shared_mutex>
+
+#include "library.h"
+
+// ==================== Branch Network ====================>
+
+// A title with free copies at one branch
+struct BranchCopy {
+    string branch;
+    string isbn;
+    string title;
+    string author;
+    int available;
+    int inventory;
+};
+
+// Several branches, each a Library with its own catalog file.
+//
+// The branch list is fixed at construction, so finding a branch needs no shared lock. Each branch
+// has its own reader-writer lock: operations on one branch only take that branch's lock, and the
+// cross-branch availability query takes each branch's shared lock while it reads that branch.
+class BranchNetwork {
+    struct Branch {
+        string name;
+        Library library;
+        mutable shared_mutex branch_mutex;
+
+        Branch(string name, string filename) : name(std::move(name)), library(std::move(filename)) {}
+    };
+
+    vector<unique_ptr<Branch>> branches;
+    map<string, size_t, less<>> branch_index;
+
+    static void addIfAvailable(const Branch &branch, const Book &book, vector<BranchCopy> &copies) {
+        int available = book.getAvailableCount();
+        if (available > 0) {
+            copies.push_back({branch.name, book.getISBN(), book.getTitle(), book.getAuthor(), available, book.getInventoryCount()});
+        }
+    }
+
+    // Free copies at one branch of titles whose title or author contains `text`
+    static void searchAvailable(const Branch &branch, const string &text, vector<BranchCopy> &copies) {
+        shared_lock<shared_mutex> lock(branch.branch_mutex);
+        for (const auto &book: branch.library.getBooks()) {
+            if (book.getTitle().find(text) != string::npos || book.getAuthor().find(text) != string::npos) {
+                addIfAvailable(branch, book, copies);
+            }
+        }
+    }
+
+public:
+    // Branch names may use letters, digits, '-' and '_'
+    static bool isValidName(const string &name) {
+        return !name.empty() && all_of(name.begin(), name.end(), [](char c) { return isalnum(uint8_t(c)) || c == '-' || c == '_'; });
+    }
+
+    static string catalogFileOf(const string &branch) { return "library_books_" + branch + ".csv"; }
+
+    // Open every named branch from its own catalog file; in memory only when persist is false.
+    // Invalid and repeated names are skipped.
+    explicit BranchNetwork(const vector<string> &names, bool persist = true) {
+        for (const auto &name: names) {
+            if (!isValidName(name) || branch_index.count(name)) { continue; }
+            branch_index.emplace(name, branches.size());
+            branches.push_back(make_unique<Branch>(name, persist ? catalogFileOf(name) : ""));
+        }
+    }
+
+    size_t branchCount() const { return branches.size(); }
+    const string &branchName(size_t branch) const { return branches[branch]->name; }
+
+    optional<size_t> findBranch(string_view name) const {
+        auto it = branch_index.find(name);
+        if (it == branch_index.end()) { return nullopt; }
+        return it->second;
+    }
+
+    // Run an operation on one branch's library, excluding cross-branch queries from that branch only
+    template<typename Operation>
+    decltype(auto) withBranch(size_t branch, Operation &&operation) {
+        unique_lock<shared_mutex> lock(branches[branch]->branch_mutex);
+        return operation(branches[branch]->library);
+    }
+
+    // Branches with a free copy of the title with ISBN `query`; when no branch holds that ISBN, of
+    // titles whose title or author contains it. ISBN lookups are index probes and run inline; the
+    // text scan searches branches in parallel. Copies are ordered by branch then ISBN.
+    vector<BranchCopy> whereAvailable(const string &query,
+                                      unsigned thread_count = max(1u, thread::hardware_concurrency())) const {
+        vector<BranchCopy> copies;
+        bool held = false;
+        for (const auto &branch: branches) {
+            shared_lock<shared_mutex> lock(branch->branch_mutex);
+            if (const Book *book = as_const(branch->library).findBook(string_view(query))) {
+                held = true;
+                addIfAvailable(*branch, *book, copies);
+            }
+        }
+        if (held) { return copies; }
+
+        size_t chunks = max<size_t>(1, min<size_t>(thread_count, branches.size()));
+        vector<vector<BranchCopy>> results(chunks);
+        auto searchChunk = [&](size_t c) {
+            for (size_t b = c; b < branches.size(); b += chunks) {
+                searchAvailable(*branches[b], query, results[c]);
+            }
+        };
+
+        vector<thread> workers;
+        for (size_t c = 1; c < chunks; ++c) {
+            workers.emplace_back(searchChunk, c);
+        }
+        searchChunk(0);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+
+        for (auto &result: results) {
+            move(result.begin(), result.end(), back_inserter(copies));
+        }
+        sort(copies.begin(), copies.end(), [](const BranchCopy &a, const BranchCopy &b) {
+            return tie(a.branch, a.isbn) < tie(b.branch, b.isbn);
+        });
+        return copies;
+    }
+};
+
+#endif //LMS_BRANCHES_H
@@ -0,0 +1,90 @@
+#ifndef LMS_CATALOG_WATCH_H
+#define LMS_CATALOG_WATCH_H
+
+#include <atomic>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include "library.h"
+
+// ==================== Catalog Watcher ====================>
+
+// Calls on_change on a background thread when another program saves a catalog file.
+//
+// The file's directory is watched rather than the file, so editors that save by writing a new
+// file and renaming it over the old one are seen as well as ones that rewrite it in place. Edits
+// are batched: on_change runs once the file has been quiet for settle_ms.
+class CatalogWatcher {
+    string name; // file name within the watched directory
+    int inotify_fd = -1;
+    int wake_fd = -1;
+    int settle_ms;
+    function<void()> on_change;
+    atomic<bool> stopping{false};
+    thread watcher;
+
+    // Read the queued events; true when one of them finished writing the file or moved a file onto it
+    bool drain() {
+        alignas(inotify_event) char buffer[4096];
+        bool touched = false;
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *p = buffer; p < buffer + length;) {
+                auto *event = reinterpret_cast<inotify_event *>(p);
+                if (event->len > 0 && name == event->name) { touched = true; }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        return touched;
+    }
+
+    void watch() {
+        pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+        bool pending = false;
+        while (!stopping) {
+            int ready = poll(fds, 2, pending ? settle_ms : -1);
+            if (ready < 0 && errno != EINTR) { break; }
+            if (stopping) { break; }
+
+            if (ready > 0 && (fds[0].revents & POLLIN)) {
+                pending = drain() || pending;
+            } else if (ready == 0 && pending) {
+                pending = false;
+                on_change();
+            }
+        }
+    }
+
+public:
+    CatalogWatcher(const string &path, function<void()> on_change, int settle_ms = 200)
+        : settle_ms(settle_ms), on_change(std::move(on_change)) {
+        size_t slash = path.rfind('/');
+        string directory = slash == string::npos ? "." : path.substr(0, max<size_t>(slash, 1));
+        name = slash == string::npos ? path : path.substr(slash + 1);
+
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (inotify_fd < 0 || wake_fd < 0 || inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            cerr << "Error: Unable to watch " << path << " for changes." << endl;
+            return;
+        }
+
+        watcher = thread(&CatalogWatcher::watch, this);
+    }
+
+    ~CatalogWatcher() {
+        stopping = true;
+        if (watcher.joinable()) {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t written = write(wake_fd, &one, sizeof(one));
+            watcher.join();
+        }
+        if (inotify_fd >= 0) { close(inotify_fd); }
+        if (wake_fd >= 0) { close(wake_fd); }
+    }
+
+    bool isWatching() const { return watcher.joinable(); }
+};
+
+#endif //LMS_CATALOG_WATCH_H
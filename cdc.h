@@ -0,0 +1,313 @@
+#ifndef LMS_CDC_H
+#define LMS_CDC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+
+#include "sockets.h"
+
+// ==================== Change Feed ====================>
+
+// Publishes every committed mutation as a sequenced change event to subscribers on a Unix socket.
+//
+// Events are appended to a log file, one Mutation::toString line each, whose seq is the event's
+// offset: its line number in the log. Offsets therefore survive restarts, and a subscriber can
+// resume from any offset still in the log. Catch-up reads come from the file, so the library never
+// waits for a subscriber and a slow one only falls behind.
+//
+// Protocol (one record per line):
+//   subscriber -> feed: SUBSCRIBE <name> <offset|-> <window>
+//                         start after <offset>, or with "-" after the name's last acknowledged
+//                         offset; at most <window> events are sent beyond the last acknowledgement
+//                       ACK <offset>  (every event up to <offset> is applied)
+//   feed -> subscriber: E <offset>\t<commit ms>\t<type>\t<isbn>\t<payload>
+//                       H <head offset>  (heartbeat while there is nothing to send)
+class ChangeFeed {
+    static constexpr size_t MAX_BATCH_BYTES = 256 * 1024;
+    static constexpr int HEARTBEAT_MS = 1000;
+
+    struct Subscriber {
+        int fd;
+        string name;
+        uint64_t acked = 0;
+        thread writer;
+        thread reader;
+        bool done = false;             // either side hung up
+        atomic<bool> exited{false};    // the writer has released the feed for good
+    };
+
+    string log_path;
+    string socket_path;
+    int log_fd = -1;
+    int listen_fd = -1;
+
+    mutex feed_mutex;
+    condition_variable feed_changed;
+    vector<uint64_t> event_positions; // byte position of each event in the log; offset i + 1
+    uint64_t log_bytes = 0;
+    map<string, uint64_t> committed; // last acknowledged offset per subscriber name
+    list<Subscriber> subscribers;
+    atomic<bool> stopping{false};
+    thread accept_thread;
+
+    string offsetsPath() const { return log_path + ".offsets"; }
+
+    // Index the events already in the log, dropping a torn last line, and read committed offsets
+    void openLog() {
+        string data;
+        {
+            ifstream inFile(log_path, ios::binary);
+            data.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        }
+        for (size_t begin = 0; begin < data.size();) {
+            size_t end = data.find('\n', begin);
+            if (end == string::npos) { break; }
+            event_positions.push_back(begin);
+            begin = end + 1;
+            log_bytes = begin;
+        }
+        if (log_bytes != data.size() && truncate(log_path.c_str(), off_t(log_bytes)) != 0) {
+            cerr << "Error: Unable to repair change log " << log_path << "." << endl;
+        }
+        log_fd = open(log_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+
+        ifstream offsetsFile(offsetsPath());
+        string name;
+        uint64_t offset;
+        while (offsetsFile >> name >> offset) {
+            committed[name] = offset;
+        }
+    }
+
+    void saveCommittedOffsets() {
+        string out;
+        for (const auto &[name, offset]: committed) {
+            out += name + " " + to_string(offset) + "\n";
+        }
+        ofstream(offsetsPath(), ios::binary | ios::trunc).write(out.data(), streamsize(out.size()));
+    }
+
+    void acceptLoop() {
+        while (!stopping) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) { continue; }
+
+            // Threads of subscribers that hung up are joined outside the lock they may still take
+            list<Subscriber> finished;
+            {
+                lock_guard<mutex> lock(feed_mutex);
+                if (stopping) {
+                    close(fd);
+                    break;
+                }
+                for (auto it = subscribers.begin(); it != subscribers.end();) {
+                    auto next = std::next(it);
+                    if (it->exited) { finished.splice(finished.end(), subscribers, it); }
+                    it = next;
+                }
+                Subscriber &subscriber = subscribers.emplace_back();
+                subscriber.fd = fd;
+                subscriber.writer = thread(&ChangeFeed::serveSubscriber, this, &subscriber);
+            }
+            for (auto &subscriber: finished) {
+                subscriber.writer.join();
+                subscriber.reader.join();
+                close(subscriber.fd);
+            }
+        }
+    }
+
+    void serveSubscriber(Subscriber *subscriber) {
+        auto reader = make_shared<LineReader>(subscriber->fd);
+        string request, tag, name, from;
+        size_t window = 0;
+        if (reader->readLine(request)) { istringstream(request) >> tag >> name >> from >> window; }
+
+        unique_lock<mutex> lock(feed_mutex);
+        uint64_t sent = 0;
+        bool valid = tag == "SUBSCRIBE" && !name.empty() && window > 0;
+        if (valid) {
+            subscriber->name = name;
+            if (from == "-") {
+                sent = committed.count(name) ? committed[name] : 0;
+            } else {
+                auto [end, error] = from_chars(from.data(), from.data() + from.size(), sent);
+                valid = error == errc() && end == from.data() + from.size();
+            }
+        }
+        sent = min<uint64_t>(sent, event_positions.size());
+        subscriber->acked = sent;
+        subscriber->reader = thread(&ChangeFeed::readAcks, this, subscriber, reader);
+
+        while (valid && !stopping && !subscriber->done) {
+            uint64_t head = event_positions.size();
+            uint64_t limit = min<uint64_t>(head, subscriber->acked + window);
+            if (sent >= limit) {
+                bool changed = feed_changed.wait_for(lock, chrono::milliseconds(HEARTBEAT_MS), [&] {
+                    return stopping || subscriber->done || min<uint64_t>(event_positions.size(), subscriber->acked + window) > sent;
+                });
+                if (!changed) {
+                    string heartbeat = "H " + to_string(head) + "\n";
+                    lock.unlock();
+                    valid = sendAll(subscriber->fd, heartbeat);
+                    lock.lock();
+                }
+                continue;
+            }
+
+            // Events sent + 1 .. last, as one read of the log
+            uint64_t begin = event_positions[sent], last = sent;
+            while (last < limit && (last + 1 == head ? log_bytes : event_positions[last + 1]) - begin <= MAX_BATCH_BYTES) {
+                ++last;
+            }
+            last = max(last, sent + 1);
+            uint64_t end = last == head ? log_bytes : event_positions[last];
+            lock.unlock();
+
+            string data(end - begin, '\0');
+            valid = pread(log_fd, data.data(), data.size(), off_t(begin)) == ssize_t(data.size());
+            string out;
+            out.reserve(data.size() + (last - sent) * 2);
+            for (size_t pos = 0; valid && pos < data.size();) {
+                size_t eol = data.find('\n', pos);
+                out += "E ";
+                out.append(data, pos, eol - pos + 1);
+                pos = eol + 1;
+            }
+            valid = valid && sendAll(subscriber->fd, out);
+            lock.lock();
+            sent = last;
+        }
+
+        subscriber->done = true;
+        lock.unlock();
+        shutdown(subscriber->fd, SHUT_RDWR);
+        subscriber->exited = true;
+    }
+
+    // Record acknowledgements, which open the subscriber's window and commit its offset
+    void readAcks(Subscriber *subscriber, shared_ptr<LineReader> reader) {
+        string line;
+        while (reader->readLine(line)) {
+            uint64_t offset;
+            if (line.rfind("ACK ", 0) != 0 || from_chars(line.data() + 4, line.data() + line.size(), offset).ec != errc()) {
+                break;
+            }
+
+            lock_guard<mutex> lock(feed_mutex);
+            if (offset > subscriber->acked && offset <= event_positions.size()) {
+                subscriber->acked = offset;
+                committed[subscriber->name] = offset;
+                saveCommittedOffsets();
+            }
+            feed_changed.notify_all();
+        }
+
+        lock_guard<mutex> lock(feed_mutex);
+        subscriber->done = true;
+        feed_changed.notify_all();
+    }
+
+public:
+    ChangeFeed(string socket_path, string log_path = "library_changes.log") {
+        this->socket_path = socket_path;
+        this->log_path = log_path;
+        openLog();
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = unixAddress(socket_path);
+        unlink(socket_path.c_str());
+        if (log_fd < 0 || listen_fd < 0 || bind(listen_fd, (sockaddr *) &addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+            cerr << "Error: Unable to start the change feed on " << socket_path << "." << endl;
+            return;
+        }
+
+        accept_thread = thread(&ChangeFeed::acceptLoop, this);
+    }
+
+    ~ChangeFeed() {
+        stopping = true;
+        feed_changed.notify_all();
+
+        if (listen_fd >= 0) {
+            shutdown(listen_fd, SHUT_RDWR);
+            close(listen_fd);
+            unlink(socket_path.c_str());
+        }
+        if (accept_thread.joinable()) { accept_thread.join(); }
+
+        {
+            lock_guard<mutex> lock(feed_mutex);
+            for (auto &subscriber: subscribers) {
+                shutdown(subscriber.fd, SHUT_RDWR);
+            }
+        }
+        for (auto &subscriber: subscribers) {
+            if (subscriber.writer.joinable()) { subscriber.writer.join(); }
+            if (subscriber.reader.joinable()) { subscriber.reader.join(); }
+            close(subscriber.fd);
+        }
+        if (log_fd >= 0) { close(log_fd); }
+    }
+
+    // Append a committed mutation to the log as the next event
+    void publish(const Mutation &mutation) {
+        lock_guard<mutex> lock(feed_mutex);
+        if (log_fd < 0) { return; }
+
+        Mutation event(event_positions.size() + 1, mutation.commit_ms, mutation.type, mutation.isbn, mutation.payload);
+        string line = event.toString() + "\n";
+        if (write(log_fd, line.data(), line.size()) != ssize_t(line.size())) {
+            cerr << "Error: Unable to append to change log " << log_path << "." << endl;
+            return;
+        }
+        event_positions.push_back(log_bytes);
+        log_bytes += line.size();
+        feed_changed.notify_all();
+    }
+
+    // Offset of the last event
+    uint64_t headOffset() {
+        lock_guard<mutex> lock(feed_mutex);
+        return event_positions.size();
+    }
+};
+
+// ==================== Change Feed Subscriber ====================>
+
+// Follow a change feed: connect, resume after the last acknowledged offset, and acknowledge each
+// batch once `apply` has handled it. Returns when the feed hangs up.
+inline bool followChangeFeed(const string &socket_path, const string &name, size_t window,
+                             const function<void(const Mutation &)> &apply) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = unixAddress(socket_path);
+    if (fd < 0 || connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        if (fd >= 0) { close(fd); }
+        return false;
+    }
+
+    bool ok = sendAll(fd, "SUBSCRIBE " + name + " - " + to_string(window) + "\n");
+    LineReader reader(fd);
+    string line;
+    size_t pending = 0;
+    uint64_t last = 0;
+    while (ok && reader.readLine(line)) {
+        if (line.rfind("E ", 0) == 0) {
+            Mutation mutation = Mutation::fromString(line.substr(2));
+            apply(mutation);
+            last = mutation.seq;
+            ++pending;
+        }
+        // Acknowledge half a window at a time, and whatever is left once the feed goes idle
+        if (pending > 0 && (pending >= max<size_t>(1, window / 2) || line[0] == 'H')) {
+            ok = sendAll(fd, "ACK " + to_string(last) + "\n");
+            pending = 0;
+        }
+    }
+    close(fd);
+    return true;
+}
+
+#endif //LMS_CDC_H
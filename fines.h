@@ -0,0 +1,224 @@
+#ifndef LMS_FINES_H
+#define LMS_FINES_H
+
+#include "library.h"
+
+// ==================== Fee Schedule ====================>
+
+// Daily fee from the day after `after_days` days overdue
+struct FeeTier {
+    int32_t after_days;
+    int32_t cents_per_day;
+};
+
+// Tiered overdue fees: each tier charges its daily fee until the next tier starts, and the total per
+// loan is capped at cap_cents
+class FeeSchedule {
+    vector<FeeTier> tiers;
+    int32_t cap_cents;
+
+public:
+    // Lateness beyond this many days is charged as this many
+    static constexpr int32_t MAX_DAYS = 10000;
+
+    FeeSchedule(vector<FeeTier> tiers = {{0, 25}, {7, 50}, {28, 100}}, int32_t cap_cents = 5000)
+        : tiers(std::move(tiers)), cap_cents(cap_cents) {}
+
+    const vector<FeeTier> &getTiers() const { return tiers; }
+    int32_t getCapCents() const { return cap_cents; }
+
+    // Fee for a loan `days` days overdue
+    int32_t fineFor(int32_t days) const {
+        days = min(days, MAX_DAYS);
+        int64_t fine = 0;
+        for (size_t i = 0; i < tiers.size(); ++i) {
+            int32_t end = i + 1 < tiers.size() ? tiers[i + 1].after_days : MAX_DAYS;
+            fine += int64_t(tiers[i].cents_per_day) * clamp(days - tiers[i].after_days, 0, end - tiers[i].after_days);
+        }
+        return int32_t(min<int64_t>(fine, cap_cents));
+    }
+
+    // "<after_days>:<cents_per_day>,...[,cap:<cents>]" with after_days strictly increasing
+    static optional<FeeSchedule> parse(const string &spec) {
+        vector<FeeTier> tiers;
+        int32_t cap_cents = INT32_MAX;
+        istringstream ss(spec);
+        string entry;
+        while (getline(ss, entry, ',')) {
+            size_t colon = entry.find(':');
+            if (colon == string::npos) { return nullopt; }
+            string key = entry.substr(0, colon);
+            int32_t value;
+            auto [end, error] = from_chars(entry.data() + colon + 1, entry.data() + entry.size(), value);
+            if (error != errc() || end != entry.data() + entry.size() || value < 0) { return nullopt; }
+
+            if (key == "cap") {
+                cap_cents = value;
+                continue;
+            }
+            int32_t after_days;
+            auto [key_end, key_error] = from_chars(key.data(), key.data() + key.size(), after_days);
+            if (key_error != errc() || key_end != key.data() + key.size() || after_days < 0 || after_days >= MAX_DAYS ||
+                (!tiers.empty() && after_days <= tiers.back().after_days)) {
+                return nullopt;
+            }
+            tiers.push_back({after_days, value});
+        }
+        if (tiers.empty()) { return nullopt; }
+
+        // The kernel sums fees in 32-bit lanes
+        FeeSchedule schedule(std::move(tiers), INT32_MAX);
+        int64_t most = 0;
+        for (size_t i = 0; i < schedule.tiers.size(); ++i) {
+            int32_t end = i + 1 < schedule.tiers.size() ? schedule.tiers[i + 1].after_days : MAX_DAYS;
+            most += int64_t(schedule.tiers[i].cents_per_day) * (end - schedule.tiers[i].after_days);
+        }
+        if (most > INT32_MAX) { return nullopt; }
+        schedule.cap_cents = cap_cents;
+        return schedule;
+    }
+};
+
+// ==================== Overdue Kernel ====================>
+
+// Totals of one fine run
+struct FineSummary {
+    size_t loans = 0;
+    size_t overdue = 0;
+    int64_t total_cents = 0;
+};
+
+// Batch overdue classification and fines over a contiguous array of return dates.
+//
+// One clock snapshot is taken for the whole batch. Four return dates are processed per step with
+// GCC vector extensions, which the compiler maps onto SSE2 or AVX2 registers: lateness is clamped
+// in 64-bit lanes, narrowed, turned into whole days overdue with an exact double division, and
+// priced tier by tier with lane-wise min/max. The tail goes through FeeSchedule::fineFor.
+class OverdueKernel {
+    using Int64x4 = int64_t __attribute__((vector_size(32)));
+    using Int32x4 = int32_t __attribute__((vector_size(16)));
+    using Doublex4 = double __attribute__((vector_size(32)));
+
+    static constexpr time_t DAY_SECONDS = 24 * 60 * 60;
+    static constexpr size_t LANES = 4;
+
+public:
+    // Write each loan's whole days overdue (0 when not overdue, a started day counts) and fine
+    static FineSummary run(span<const time_t> return_dates, time_t now, const FeeSchedule &schedule,
+                           span<int32_t> days_overdue, span<int32_t> fines) {
+        static_assert(sizeof(time_t) == sizeof(int64_t));
+        size_t count = min({return_dates.size(), days_overdue.size(), fines.size()});
+        const vector<FeeTier> &tiers = schedule.getTiers();
+
+        const Int64x4 zero64 = {}, max_late = Int64x4{} + int64_t(FeeSchedule::MAX_DAYS) * DAY_SECONDS;
+        const Int64x4 now64 = Int64x4{} + int64_t(now);
+        const Int32x4 zero32 = {}, cap = Int32x4{} + schedule.getCapCents();
+        const Doublex4 day = Doublex4{} + double(DAY_SECONDS);
+
+        FineSummary summary;
+        summary.loans = count;
+        Int32x4 overdue_lanes = {};
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            Int64x4 due;
+            memcpy(&due, return_dates.data() + i, sizeof(due));
+
+            Int64x4 late = now64 - due;
+            late = late < zero64 ? zero64 : late;
+            late = late > max_late ? max_late : late;
+            Int32x4 late32 = __builtin_convertvector(late + (DAY_SECONDS - 1), Int32x4);
+            Int32x4 days = __builtin_convertvector(__builtin_convertvector(late32, Doublex4) / day, Int32x4);
+
+            Int32x4 fine = {};
+            for (size_t t = 0; t < tiers.size(); ++t) {
+                int32_t end = t + 1 < tiers.size() ? tiers[t + 1].after_days : FeeSchedule::MAX_DAYS;
+                Int32x4 charged = days - tiers[t].after_days;
+                charged = charged < zero32 ? zero32 : charged;
+                charged = charged > end - tiers[t].after_days ? Int32x4{} + (end - tiers[t].after_days) : charged;
+                fine += charged * tiers[t].cents_per_day;
+            }
+            fine = fine > cap ? cap : fine;
+
+            memcpy(days_overdue.data() + i, &days, sizeof(days));
+            memcpy(fines.data() + i, &fine, sizeof(fine));
+            overdue_lanes -= days > zero32; // true lanes are -1
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                summary.total_cents += fine[lane];
+            }
+        }
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            summary.overdue += size_t(overdue_lanes[lane]);
+        }
+
+        for (; i < count; ++i) {
+            time_t late = clamp<time_t>(now - return_dates[i], 0, time_t(FeeSchedule::MAX_DAYS) * DAY_SECONDS);
+            days_overdue[i] = int32_t((late + DAY_SECONDS - 1) / DAY_SECONDS);
+            fines[i] = schedule.fineFor(days_overdue[i]);
+            summary.overdue += days_overdue[i] > 0;
+            summary.total_cents += fines[i];
+        }
+        return summary;
+    }
+};
+
+// Every active loan of a catalog laid out for the kernel
+struct LoanBatch {
+    vector<time_t> return_dates;
+    vector<pair<uint32_t, uint32_t>> loans; // book position, borrower position
+    vector<int32_t> days_overdue;
+    vector<int32_t> fines;
+
+    explicit LoanBatch(span<const Book> books) {
+        for (uint32_t b = 0; b < books.size(); ++b) {
+            const auto &borrowers = books[b].getBorrowers();
+            for (uint32_t l = 0; l < borrowers.size(); ++l) {
+                return_dates.push_back(borrowers[l].getReturnDate());
+                loans.emplace_back(b, l);
+            }
+        }
+        days_overdue.resize(loans.size());
+        fines.resize(loans.size());
+    }
+
+    FineSummary run(time_t now, const FeeSchedule &schedule) {
+        return OverdueKernel::run(return_dates, now, schedule, days_overdue, fines);
+    }
+
+    // "isbn,name,mobile,email,return_date,days_overdue,fine" rows for the overdue loans, quoted as
+    // the CSV export is
+    bool writeCsv(const string &path, span<const Book> books) const {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { return false; }
+
+        bool ok;
+        {
+            ExportWriter writer(fd, ExportFormat::CSV);
+            writer.header({"isbn", "name", "mobile", "email", "return_date", "days_overdue", "fine"});
+            for (size_t i = 0; i < loans.size(); ++i) {
+                if (days_overdue[i] == 0) { continue; }
+                const Book &book = books[loans[i].first];
+                const Borrower &borrower = book.getBorrowers()[loans[i].second];
+                writer.text(book.getISBN());
+                writer.text(borrower.getName());
+                writer.text(borrower.getMobile());
+                writer.text(borrower.getEmail());
+                writer.date(borrower.getReturnDate());
+                writer.number(days_overdue[i]);
+
+                char fine[24];
+                char *last = to_chars(fine, fine + sizeof(fine), fines[i] / 100).ptr;
+                *last++ = '.';
+                *last++ = char('0' + fines[i] % 100 / 10);
+                *last++ = char('0' + fines[i] % 10);
+                writer.text(string(fine, last));
+                writer.endRow();
+            }
+            writer.flush();
+            ok = writer.ok();
+        }
+        close(fd);
+        return ok;
+    }
+};
+
+#endif //LMS_FINES_H
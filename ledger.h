@@ -0,0 +1,338 @@
+#ifndef LMS_LEDGER_H
+#define LMS_LEDGER_H
+
+#include <unordered_map>
+
+#include "library.h"
+
+// ==================== Loan Ledger ====================>
+
+// A borrow or return in the loan history
+struct LoanEvent {
+    enum Type : uint8_t { BORROW = 0, RETURN = 1 };
+
+    Type type;
+    time_t time;
+    time_t due; // return date of the loan (borrow events only)
+    uint32_t book_id;
+    uint32_t patron_id;
+};
+
+// Append-only history of borrow and return events.
+//
+// Events are packed into blocks of BLOCK_EVENTS: each event stores its time as a zigzag varint
+// delta from the previous event, and interned book and patron ids as varints, typically 5-8 bytes
+// per event. Blocks record their time range, so a time range scan skips whole blocks, and each book
+// keeps the list of blocks it appears in, so a per-book scan only decodes those blocks.
+// The same encoding is appended to the ledger file and replayed on startup. Several processes may
+// append to one file: each append holds a write lock on the file and first replays the records
+// others appended, so interned ids and time deltas continue from the file's last record.
+class LoanLedger {
+    static constexpr size_t BLOCK_EVENTS = 4096;
+
+    struct Block {
+        size_t offset;
+        size_t count = 0;
+        time_t first_time;
+        time_t min_time;
+        time_t max_time;
+    };
+
+    vector<uint8_t, TrackingAllocator<uint8_t, MemorySubsystem::LEDGER>> bytes;
+    vector<Block, TrackingAllocator<Block, MemorySubsystem::LEDGER>> blocks;
+    time_t previous_time = 0;
+
+    vector<string> book_keys;
+    unordered_map<string, uint32_t> book_ids;
+    vector<vector<uint32_t>> book_blocks;
+    vector<string> patron_keys;
+    unordered_map<string, uint32_t> patron_ids;
+
+    string filename;
+    int fd = -1;
+    uint64_t file_bytes = 0; // length of the file as this process last replayed or wrote it
+    time_t previous_file_time = 0;
+
+    template<class Bytes>
+    static void putVarint(Bytes &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    static uint64_t getVarint(const uint8_t *&in) {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = *in++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (byte < 0x80) { return value; }
+        }
+    }
+
+    // Read a varint from untrusted bytes; false when it runs past end or overflows 64 bits
+    static bool getVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7) {
+            uint8_t byte = *in++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (byte < 0x80) { return true; }
+        }
+        return false;
+    }
+
+    static uint64_t zigzag(int64_t value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+    static int64_t unzigzag(uint64_t value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+    static uint32_t intern(const string &key, vector<string> &keys, unordered_map<string, uint32_t> &ids,
+                           bool &added) {
+        auto [it, inserted] = ids.emplace(key, uint32_t(keys.size()));
+        if (inserted) { keys.push_back(key); }
+        added = inserted;
+        return it->second;
+    }
+
+    // Decode every event of a block
+    template<typename Callback>
+    void decodeBlock(const Block &block, Callback &&callback) const {
+        const uint8_t *in = bytes.data() + block.offset;
+        time_t time = block.first_time;
+        for (size_t i = 0; i < block.count; ++i) {
+            LoanEvent event;
+            time += unzigzag(getVarint(in));
+            uint64_t book_and_type = getVarint(in);
+            event.type = LoanEvent::Type(book_and_type & 1);
+            event.book_id = uint32_t(book_and_type >> 1);
+            event.patron_id = uint32_t(getVarint(in));
+            event.due = event.type == LoanEvent::BORROW ? time + unzigzag(getVarint(in)) : 0;
+            event.time = time;
+            callback(event);
+        }
+    }
+
+    // Add an event to the in-memory blocks
+    void appendEvent(const LoanEvent &event) {
+        if (blocks.empty() || blocks.back().count == BLOCK_EVENTS) {
+            blocks.push_back({bytes.size(), 0, event.time, event.time, event.time});
+            previous_time = event.time;
+        }
+
+        Block &block = blocks.back();
+        putVarint(bytes, zigzag(event.time - previous_time));
+        putVarint(bytes, uint64_t(event.book_id) << 1 | event.type);
+        putVarint(bytes, event.patron_id);
+        if (event.type == LoanEvent::BORROW) { putVarint(bytes, zigzag(event.due - event.time)); }
+
+        previous_time = event.time;
+        block.min_time = min(block.min_time, event.time);
+        block.max_time = max(block.max_time, event.time);
+        ++block.count;
+
+        if (book_blocks.size() <= event.book_id) { book_blocks.resize(event.book_id + 1); }
+        vector<uint32_t> &postings = book_blocks[event.book_id];
+        if (postings.empty() || postings.back() != blocks.size() - 1) { postings.push_back(uint32_t(blocks.size() - 1)); }
+    }
+
+    // Replay ledger records: 'K' book key, 'P' patron key, 'E' event. Returns the length of the
+    // complete records; valid is false when replay stopped at an invalid one.
+    size_t replay(const vector<uint8_t> &data, bool &valid) {
+        const uint8_t *in = data.data();
+        const uint8_t *end = in + data.size();
+        const uint8_t *complete = in; // end of the last record replayed
+        valid = true;
+        while (in < end && valid) {
+            uint8_t tag = *in++;
+            uint64_t length, delta, book_and_type, patron_id, due = 0;
+            if (tag == 'K' || tag == 'P') {
+                if (!getVarint(in, end, length) || length > uint64_t(end - in)) { break; }
+                string key(reinterpret_cast<const char *>(in), length);
+                in += length;
+                bool added;
+                if (tag == 'K') {
+                    intern(key, book_keys, book_ids, added);
+                } else {
+                    intern(key, patron_keys, patron_ids, added);
+                }
+                valid = added;
+            } else if (tag == 'E') {
+                if (!getVarint(in, end, delta) || !getVarint(in, end, book_and_type) || !getVarint(in, end, patron_id) ||
+                    ((book_and_type & 1) == LoanEvent::BORROW && !getVarint(in, end, due))) {
+                    break;
+                }
+                valid = (book_and_type >> 1) < book_keys.size() && patron_id < patron_keys.size();
+                if (!valid) { break; }
+
+                LoanEvent event;
+                previous_file_time += unzigzag(delta);
+                event.time = previous_file_time;
+                event.type = LoanEvent::Type(book_and_type & 1);
+                event.book_id = uint32_t(book_and_type >> 1);
+                event.patron_id = uint32_t(patron_id);
+                event.due = event.type == LoanEvent::BORROW ? event.time + unzigzag(due) : 0;
+                appendEvent(event);
+            } else {
+                valid = false;
+            }
+            if (valid) { complete = in; }
+        }
+        return complete - data.data();
+    }
+
+    bool lockFile(short type) {
+        struct flock range = {};
+        range.l_type = type;
+        range.l_whence = SEEK_SET;
+        return fcntl(fd, F_SETLKW, &range) == 0;
+    }
+
+    // Replay what other processes appended since this one last read or wrote the file; with the
+    // file locked. The file is cut back at the first incomplete or invalid record, as the change
+    // log is, so later appends stay readable.
+    void syncFromFile() {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || uint64_t(st.st_size) <= file_bytes) { return; }
+        vector<uint8_t> data(uint64_t(st.st_size) - file_bytes);
+        ssize_t length = pread(fd, data.data(), data.size(), off_t(file_bytes));
+        if (length < 0) { return; }
+        data.resize(length);
+
+        bool valid;
+        size_t kept = replay(data, valid);
+        file_bytes += kept;
+        if (!valid) { cerr << "Error: Loan ledger " << filename << " is corrupt; ignoring the rest." << endl; }
+        if (kept != data.size() && ftruncate(fd, off_t(file_bytes)) != 0) {
+            cerr << "Error: Unable to repair loan ledger " << filename << "." << endl;
+        }
+    }
+
+    static void putKey(vector<uint8_t> &out, char tag, const string &key) {
+        out.push_back(uint8_t(tag));
+        putVarint(out, key.size());
+        out.insert(out.end(), key.begin(), key.end());
+    }
+
+public:
+    // Open a ledger; an empty filename keeps it in memory only
+    explicit LoanLedger(string filename = "library_loans.ledger") {
+        this->filename = filename;
+        if (filename.empty()) { return; }
+
+        TraceSpan span("ledger.load");
+        fd = open(this->filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0 || !lockFile(F_WRLCK)) {
+            cerr << "Error: Unable to open loan ledger " << this->filename << "." << endl;
+            return;
+        }
+        syncFromFile();
+        lockFile(F_UNLCK);
+    }
+
+    ~LoanLedger() {
+        if (fd >= 0) { close(fd); }
+    }
+
+    // Record a borrow or return
+    void record(LoanEvent::Type type, const string &isbn, const Borrower &borrower, time_t time, time_t due) {
+        if (fd >= 0) {
+            lockFile(F_WRLCK);
+            syncFromFile();
+        }
+
+        bool new_book, new_patron;
+        LoanEvent event;
+        event.type = type;
+        event.time = time;
+        event.due = due;
+        event.book_id = intern(isbn, book_keys, book_ids, new_book);
+        event.patron_id = intern(borrower.getName() + "|" + borrower.getMobile() + "|" + borrower.getEmail(),
+                                 patron_keys, patron_ids, new_patron);
+        appendEvent(event);
+
+        if (fd < 0) { return; }
+        vector<uint8_t> records;
+        if (new_book) { putKey(records, 'K', isbn); }
+        if (new_patron) { putKey(records, 'P', patron_keys[event.patron_id]); }
+        records.push_back('E');
+        putVarint(records, zigzag(event.time - previous_file_time));
+        putVarint(records, uint64_t(event.book_id) << 1 | event.type);
+        putVarint(records, event.patron_id);
+        if (type == LoanEvent::BORROW) { putVarint(records, zigzag(event.due - event.time)); }
+
+        if (write(fd, records.data(), records.size()) == ssize_t(records.size())) {
+            file_bytes += records.size();
+            previous_file_time = event.time;
+            lockFile(F_UNLCK);
+            return;
+        }
+        // The file no longer holds every key this process interned, so stop appending to it
+        cerr << "Error: Unable to write loan ledger " << filename << "; later loans are kept in memory only." << endl;
+        [[maybe_unused]] int result = ftruncate(fd, off_t(file_bytes));
+        close(fd);
+        fd = -1;
+    }
+
+    // Replay loans other processes appended to the ledger file
+    void refresh() {
+        if (fd < 0) { return; }
+        lockFile(F_WRLCK);
+        syncFromFile();
+        lockFile(F_UNLCK);
+    }
+
+    // Record the loan events of a committed mutation
+    void record(const Mutation &mutation) {
+        if (mutation.type != Mutation::BORROW && mutation.type != Mutation::RETURN) { return; }
+
+        Borrower borrower = Borrower::fromString(mutation.payload);
+        if (mutation.type == Mutation::BORROW) {
+            record(LoanEvent::BORROW, mutation.isbn, borrower, borrower.getBorrowDate(), borrower.getReturnDate());
+        } else {
+            record(LoanEvent::RETURN, mutation.isbn, borrower, mutation.commit_ms / 1000, 0);
+        }
+    }
+
+    size_t eventCount() const {
+        size_t count = 0;
+        for (const auto &block: blocks) {
+            count += block.count;
+        }
+        return count;
+    }
+
+    size_t encodedBytes() const { return bytes.size(); }
+
+    const string &bookKey(uint32_t book_id) const { return book_keys[book_id]; }
+
+    // Patron identity as name|mobile|email
+    const string &patronKey(uint32_t patron_id) const { return patron_keys[patron_id]; }
+
+    // Events with from <= time < to
+    template<typename Callback>
+    void scanTimeRange(time_t from, time_t to, Callback &&callback) const {
+        for (const auto &block: blocks) {
+            if (block.max_time < from || block.min_time >= to) { continue; }
+            decodeBlock(block, [&](const LoanEvent &event) {
+                if (event.time >= from && event.time < to) { callback(event); }
+            });
+        }
+    }
+
+    // Events of one book with from <= time < to
+    template<typename Callback>
+    void scanBook(const string &isbn, time_t from, time_t to, Callback &&callback) const {
+        auto it = book_ids.find(isbn);
+        if (it == book_ids.end() || it->second >= book_blocks.size()) { return; }
+
+        uint32_t book_id = it->second;
+        for (uint32_t block_index: book_blocks[book_id]) {
+            const Block &block = blocks[block_index];
+            if (block.max_time < from || block.min_time >= to) { continue; }
+            decodeBlock(block, [&](const LoanEvent &event) {
+                if (event.book_id == book_id && event.time >= from && event.time < to) { callback(event); }
+            });
+        }
+    }
+};
+
+#endif //LMS_LEDGER_H
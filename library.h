@@ -0,0 +1,2760 @@
+#ifndef LMS_LIBRARY_H
+#define LMS_LIBRARY_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <bit>
+#include <ctime>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <optional>
+#include <span>
+#include <memory>
+#include <thread>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "metrics.h"
+
+using namespace std;
+
+// Current wall clock time in milliseconds since epoch
+inline int64_t currentTimeMillis() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Stable 64-bit FNV-1a hash, so a book keeps its shard across runs and platforms
+inline uint64_t fnv1a(const string &str) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c: str) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Append a value left-aligned in a column of the given width
+inline void appendPadded(string &out, const string &value, size_t width) {
+    out += value;
+    if (value.size() < width) { out.append(width - value.size(), ' '); }
+}
+
+// ==================== Date Formatter ====================>
+
+// Thread-safe dd-mm-YYYY formatting of timestamps in local time. Each thread caches the
+// formatted string per calendar day, so only the first timestamp of a day pays for localtime_r.
+class DateFormatter {
+    struct Entry {
+        time_t day_start = 1;
+        time_t day_end = 0; // empty range
+        char text[10];
+    };
+
+    static constexpr size_t CACHE_SIZE = 1024;
+
+    struct Cache {
+        Entry entries[CACHE_SIZE];
+        long utc_offset = 0;
+    };
+
+    static Cache &cache() {
+        thread_local Cache cache;
+        return cache;
+    }
+
+    // Fill an entry with the local calendar day containing t
+    static void load(Entry &entry, time_t t, long &utc_offset) {
+        tm day{};
+        localtime_r(&t, &day);
+        utc_offset = day.tm_gmtoff;
+
+        entry.text[0] = char('0' + day.tm_mday / 10);
+        entry.text[1] = char('0' + day.tm_mday % 10);
+        entry.text[2] = '-';
+        entry.text[3] = char('0' + (day.tm_mon + 1) / 10);
+        entry.text[4] = char('0' + (day.tm_mon + 1) % 10);
+        entry.text[5] = '-';
+        int year = day.tm_year + 1900;
+        for (int i = 9; i >= 6; --i) {
+            entry.text[i] = char('0' + year % 10);
+            year /= 10;
+        }
+
+        // Day boundaries via mktime, so days shortened or lengthened by DST stay exact
+        day.tm_hour = day.tm_min = day.tm_sec = 0;
+        day.tm_isdst = -1;
+        entry.day_start = mktime(&day);
+        day.tm_mday += 1;
+        day.tm_isdst = -1;
+        entry.day_end = mktime(&day);
+    }
+
+public:
+    static constexpr size_t LENGTH = 10;
+
+    // Write the local calendar day of t as dd-mm-YYYY into buffer (at least LENGTH bytes)
+    static size_t format(time_t t, char *buffer) {
+        Cache &local = cache();
+        Entry &entry = local.entries[size_t((t + local.utc_offset) / 86400) % CACHE_SIZE];
+        if (t < entry.day_start || t >= entry.day_end) {
+            load(entry, t, local.utc_offset);
+        }
+
+        memcpy(buffer, entry.text, LENGTH);
+        return LENGTH;
+    }
+
+    static string format(time_t t) {
+        char buffer[LENGTH];
+        return string(buffer, format(t, buffer));
+    }
+};
+
+// ==================== Borrower Class ====================>
+
+class Borrower {
+    string name;
+    string mobile;
+    string email;
+    time_t borrow_date;
+    time_t return_date;
+    uint32_t loan_slot = 0; // slot of this loan in the owning Library's loan map; not persisted
+    uint32_t copy = 0;      // number of the copy on loan, from 1; 0 until the Book places the loan
+    MemoryCharge<MemorySubsystem::BORROWERS> strings_charge;
+
+public:
+    Borrower(string name, string mobile, string email, time_t borrow_date = time(nullptr),
+             time_t return_date = time(nullptr) + 15 * 24 * 60 * 60) {
+        this->name = name;
+        this->mobile = mobile;
+        this->email = email;
+        this->borrow_date = borrow_date;
+        this->return_date = return_date;
+        strings_charge.set(stringHeapBytes(this->name) + stringHeapBytes(this->mobile) + stringHeapBytes(this->email));
+    }
+
+    // Getters
+    const string &getName() const { return name; }
+    const string &getMobile() const { return mobile; }
+    const string &getEmail() const { return email; }
+    bool isBookOverdue() const { return isBookOverdue(time(nullptr)); }
+    bool isBookOverdue(time_t now) const { return now > return_date; }
+
+    time_t getBorrowDate() const { return borrow_date; }
+    time_t getReturnDate() const { return return_date; }
+    uint32_t getLoanSlot() const { return loan_slot; }
+    void setLoanSlot(uint32_t slot) { loan_slot = slot; }
+    uint32_t getCopy() const { return copy; }
+    void setCopy(uint32_t copy) { this->copy = copy; }
+
+    string getBorrowDateStr() const { return DateFormatter::format(borrow_date); }
+    string getReturnDateStr() const { return DateFormatter::format(return_date); }
+
+    // Append the borrower details row to a buffer, judging overdue loans against `now`
+    void appendBorrowerDetails(string &out, time_t now, const string &barcode) const {
+        char date[DateFormatter::LENGTH];
+
+        appendPadded(out, name, 15);
+        appendPadded(out, mobile, 15);
+        appendPadded(out, email, 35);
+        appendPadded(out, isBookOverdue(now) ? "Overdue" : "Not Overdue", 15);
+        out.append(date, DateFormatter::format(borrow_date, date));
+        out.append(15 - DateFormatter::LENGTH, ' ');
+        out.append(date, DateFormatter::format(return_date, date));
+        out.append(15 - DateFormatter::LENGTH, ' ');
+        out += barcode;
+        out += '\n';
+    }
+
+    // Converts borrower data to string format; the copy number is left out until a copy is placed
+    string toString() const {
+        string str = name + "|" + mobile + "|" + email + "|" + to_string(borrow_date) + "|" + to_string(return_date);
+        if (copy != 0) { str += "|" + to_string(copy); }
+        return str;
+    }
+
+    // Creates a Borrower object from string data
+    static Borrower fromString(string str) {
+        string name, contact, email, borrow_date_str, return_date_str, copy_str;
+
+        istringstream ss(str);
+        getline(ss, name, '|');
+        getline(ss, contact, '|');
+        getline(ss, email, '|');
+        getline(ss, borrow_date_str, '|');
+        getline(ss, return_date_str, '|');
+        getline(ss, copy_str);
+
+        Borrower borrower(name, contact, email, stol(borrow_date_str), stol(return_date_str));
+        if (!copy_str.empty()) { borrower.copy = uint32_t(stoul(copy_str)); }
+        return borrower;
+    }
+
+    // Compare two borrowers
+    bool compare(const Borrower &borrower) const {
+        return name == borrower.name && mobile == borrower.mobile && email == borrower.email;
+    }
+};
+
+// ==================== Copy States ====================>
+
+enum class CopyState : uint8_t { AVAILABLE, ON_LOAN, LOST, DAMAGED };
+
+// States of a title's copies as bit planes: a copy is on the shelf when its bit is set in the
+// available plane, out of circulation when set in the lost or damaged plane, and on loan when set
+// in none. Up to 64 copies keep the planes inline, three bits a copy; larger inventories move them
+// to one heap block. Checkout takes the lowest copy on the shelf with a find-first-set.
+class CopySet {
+    enum Plane { AVAILABLE_PLANE, LOST_PLANE, DAMAGED_PLANE, PLANES };
+    static constexpr uint32_t INLINE_COPIES = 64;
+    using WordAllocator = TrackingAllocator<uint64_t, MemorySubsystem::BOOKS>;
+
+    uint32_t copies = 0;
+    uint32_t available = 0;
+    union {
+        uint64_t inline_words[PLANES];
+        uint64_t *heap_words;
+    };
+
+    uint32_t wordCount() const { return (copies + 63) / 64; }
+    bool isInline() const { return copies <= INLINE_COPIES; }
+
+    uint64_t *plane(Plane p) { return isInline() ? inline_words + p : heap_words + size_t(p) * wordCount(); }
+    const uint64_t *plane(Plane p) const { return isInline() ? inline_words + p : heap_words + size_t(p) * wordCount(); }
+
+    bool test(Plane p, uint32_t index) const { return plane(p)[index / 64] >> (index % 64) & 1; }
+    void set(Plane p, uint32_t index) { plane(p)[index / 64] |= uint64_t(1) << (index % 64); }
+    void reset(Plane p, uint32_t index) { plane(p)[index / 64] &= ~(uint64_t(1) << (index % 64)); }
+
+    // Size the planes for `count` copies, all cleared
+    void allocate(uint32_t count) {
+        copies = count;
+        if (isInline()) {
+            fill(begin(inline_words), end(inline_words), 0);
+        } else {
+            heap_words = WordAllocator().allocate(size_t(PLANES) * wordCount());
+            fill(heap_words, heap_words + size_t(PLANES) * wordCount(), 0);
+        }
+    }
+
+    void release() {
+        if (!isInline()) { WordAllocator().deallocate(heap_words, size_t(PLANES) * wordCount()); }
+        copies = 0;
+        available = 0;
+        fill(begin(inline_words), end(inline_words), 0);
+    }
+
+    void copyFrom(const CopySet &other) {
+        allocate(other.copies);
+        available = other.available;
+        const uint64_t *words = other.plane(AVAILABLE_PLANE);
+        copy(words, words + size_t(PLANES) * (isInline() ? 1 : wordCount()), plane(AVAILABLE_PLANE));
+    }
+
+    void moveFrom(CopySet &other) {
+        copies = other.copies;
+        available = other.available;
+        copy(begin(other.inline_words), end(other.inline_words), inline_words); // the heap pointer when not inline
+        other.copies = 0;
+        other.available = 0;
+        fill(begin(other.inline_words), end(other.inline_words), 0);
+    }
+
+public:
+    // `count` copies, all on the shelf
+    explicit CopySet(uint32_t count = 0) {
+        allocate(count);
+        uint64_t *words = plane(AVAILABLE_PLANE);
+        for (uint32_t w = 0; w < wordCount(); ++w) {
+            uint32_t bits = min<uint32_t>(64, count - w * 64);
+            words[w] = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        }
+        available = count;
+    }
+
+    CopySet(const CopySet &other) { copyFrom(other); }
+    CopySet(CopySet &&other) noexcept { moveFrom(other); }
+
+    CopySet &operator=(const CopySet &other) {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    CopySet &operator=(CopySet &&other) noexcept {
+        if (this != &other) {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~CopySet() { release(); }
+
+    uint32_t size() const { return copies; }
+    uint32_t availableCount() const { return available; }
+
+    CopyState state(uint32_t index) const {
+        if (test(AVAILABLE_PLANE, index)) { return CopyState::AVAILABLE; }
+        if (test(LOST_PLANE, index)) { return CopyState::LOST; }
+        if (test(DAMAGED_PLANE, index)) { return CopyState::DAMAGED; }
+        return CopyState::ON_LOAN;
+    }
+
+    // Take the lowest copy on the shelf
+    optional<uint32_t> checkout() {
+        const uint64_t *words = plane(AVAILABLE_PLANE);
+        for (uint32_t w = 0; w < wordCount(); ++w) {
+            if (words[w] != 0) {
+                uint32_t index = w * 64 + uint32_t(countr_zero(words[w]));
+                reset(AVAILABLE_PLANE, index);
+                --available;
+                return index;
+            }
+        }
+        return nullopt;
+    }
+
+    // Take a given copy if it is on the shelf
+    bool checkout(uint32_t index) {
+        if (index >= copies || !test(AVAILABLE_PLANE, index)) { return false; }
+        reset(AVAILABLE_PLANE, index);
+        --available;
+        return true;
+    }
+
+    // Put a copy on loan back on the shelf
+    void checkin(uint32_t index) {
+        if (index >= copies || state(index) != CopyState::ON_LOAN) { return; }
+        set(AVAILABLE_PLANE, index);
+        ++available;
+    }
+
+    // Move a copy between the shelf and the lost or damaged state; copies on loan are left alone
+    bool setState(uint32_t index, CopyState target) {
+        if (index >= copies || target == CopyState::ON_LOAN) { return false; }
+        CopyState current = state(index);
+        if (current == CopyState::ON_LOAN) { return false; }
+
+        if (current == CopyState::AVAILABLE) { --available; }
+        reset(AVAILABLE_PLANE, index);
+        reset(LOST_PLANE, index);
+        reset(DAMAGED_PLANE, index);
+        if (target == CopyState::AVAILABLE) { ++available; }
+        set(target == CopyState::AVAILABLE ? AVAILABLE_PLANE : target == CopyState::LOST ? LOST_PLANE : DAMAGED_PLANE, index);
+        return true;
+    }
+
+    // Call visit(index, state) for every lost or damaged copy, in copy order
+    template<typename Visit>
+    void forEachOutOfService(Visit &&visit) const {
+        const uint64_t *lost = plane(LOST_PLANE), *damaged = plane(DAMAGED_PLANE);
+        for (uint32_t w = 0; w < wordCount(); ++w) {
+            for (uint64_t word = lost[w] | damaged[w]; word != 0; word &= word - 1) {
+                uint32_t index = w * 64 + uint32_t(countr_zero(word));
+                visit(index, lost[w] >> (index % 64) & 1 ? CopyState::LOST : CopyState::DAMAGED);
+            }
+        }
+    }
+};
+
+// ==================== Book Class ====================>
+
+using BorrowerList = vector<Borrower, TrackingAllocator<Borrower, MemorySubsystem::BORROWERS>>;
+
+class Book {
+    string title;
+    string author;
+    string isbn;
+    int inventory_count;
+    BorrowerList borrowers;
+    CopySet copies;
+    MemoryCharge<MemorySubsystem::BOOK_STRINGS> strings_charge;
+
+    // Give a loan its own copy, if it names one still on the shelf, or else the lowest one
+    bool placeLoan(Borrower &borrower) {
+        if (borrower.getCopy() != 0 && copies.checkout(borrower.getCopy() - 1)) { return true; }
+        optional<uint32_t> copy = copies.checkout();
+        borrower.setCopy(copy ? *copy + 1 : 0);
+        return bool(copy);
+    }
+
+public:
+    // Constructor; copies listed in out_of_service (numbered from 1) are taken off the shelf before
+    // the loans are placed
+    Book(string title, string author, string isbn, int inventory_count, vector<Borrower> borrowers = {},
+         const vector<pair<uint32_t, CopyState>> &out_of_service = {})
+        : copies(uint32_t(max(inventory_count, 0))) {
+        this->title = title;
+        this->author = author;
+        this->isbn = isbn;
+        this->inventory_count = inventory_count;
+        for (const auto &[copy, state]: out_of_service) {
+            if (copy != 0) { copies.setState(copy - 1, state); }
+        }
+        this->borrowers.assign(borrowers.begin(), borrowers.end());
+        for (auto &borrower: this->borrowers) {
+            placeLoan(borrower);
+        }
+        strings_charge.set(stringHeapBytes(this->title) + stringHeapBytes(this->author) + stringHeapBytes(this->isbn));
+    }
+
+    // Getters
+    const string &getTitle() const { return title; }
+    const string &getAuthor() const { return author; }
+    const string &getISBN() const { return isbn; }
+    int getInventoryCount() const { return inventory_count; }
+    const BorrowerList &getBorrowers() const { return borrowers; }
+    int getAvailableCount() const { return int(copies.availableCount()); }
+
+    // State of a copy, numbered from 1
+    optional<CopyState> getCopyState(uint32_t copy) const {
+        if (copy == 0 || copy > copies.size()) { return nullopt; }
+        return copies.state(copy - 1);
+    }
+
+    // Mark a copy on the shelf lost or damaged, or put a lost or damaged copy back on the shelf
+    bool setCopyState(uint32_t copy, CopyState state) { return copy != 0 && copies.setState(copy - 1, state); }
+
+    // Barcode of a copy: the ISBN, '-' and the copy number padded to three digits
+    string barcodeOf(uint32_t copy) const {
+        string number = to_string(copy);
+        return isbn + "-" + string(number.size() < 3 ? 3 - number.size() : 0, '0') + number;
+    }
+
+    // ISBN and copy number of a barcode
+    static optional<pair<string, uint32_t>> parseBarcode(const string &barcode) {
+        size_t dash = barcode.rfind('-');
+        if (dash == string::npos || dash == 0) { return nullopt; }
+        uint32_t copy;
+        const char *end = barcode.data() + barcode.size();
+        auto [last, error] = from_chars(barcode.data() + dash + 1, end, copy);
+        if (error != errc() || last != end || copy == 0) { return nullopt; }
+        return pair<string, uint32_t>(barcode.substr(0, dash), copy);
+    }
+
+    // Converts book data to string format. Lost and damaged copies follow the inventory count as
+    // "~<copy>L" and "~<copy>D".
+    string toString() const {
+        string borrowersStr;
+        for (const auto &borrower: borrowers) {
+            borrowersStr += borrower.toString() + ";";
+        }
+
+        string inventory = to_string(inventory_count);
+        copies.forEachOutOfService([&](uint32_t index, CopyState state) {
+            inventory += "~" + to_string(index + 1) + (state == CopyState::LOST ? "L" : "D");
+        });
+        return title + "," + author + "," + isbn + "," + inventory + "," + borrowersStr;
+    }
+
+    // Creates a Book object from string data
+    static Book fromString(string str) {
+        string title, author, isbn, inventory_count_str, borrowersStr;
+        vector<Borrower> borrowers;
+
+        istringstream ss(str);
+        getline(ss, title, ',');
+        getline(ss, author, ',');
+        getline(ss, isbn, ',');
+        getline(ss, inventory_count_str, ',');
+        getline(ss, borrowersStr);
+
+        istringstream ssBorrowers(borrowersStr);
+        string borrowerStr;
+        while (getline(ssBorrowers, borrowerStr, ';')) {
+            borrowers.push_back(Borrower::fromString(borrowerStr));
+        }
+
+        vector<pair<uint32_t, CopyState>> out_of_service;
+        for (size_t mark = inventory_count_str.find('~'); mark != string::npos;) {
+            size_t next = inventory_count_str.find('~', mark + 1);
+            string entry = inventory_count_str.substr(mark + 1, next == string::npos ? string::npos : next - mark - 1);
+            if (entry.size() < 2 || (entry.back() != 'L' && entry.back() != 'D')) { throw invalid_argument("copy state"); }
+            out_of_service.emplace_back(uint32_t(stoul(entry)), entry.back() == 'L' ? CopyState::LOST : CopyState::DAMAGED);
+            mark = next;
+        }
+
+        return Book(title, author, isbn, stoi(inventory_count_str), borrowers, out_of_service);
+    }
+
+    // Borrow a book, lending the copy the borrower names if it is on the shelf or else the lowest one
+    bool borrowBook(const Borrower &borrower) {
+        if (copies.availableCount() == 0) { return false; }
+
+        borrowers.push_back(borrower);
+        placeLoan(borrowers.back());
+        return true;
+    }
+
+    // Whether every loan holds a copy
+    bool loansPlaced() const {
+        return all_of(borrowers.begin(), borrowers.end(), [](const Borrower &borrower) { return borrower.getCopy() != 0; });
+    }
+
+    // Return a book
+    bool returnBook(const Borrower &borrower) {
+        optional<size_t> loan = findLoan(borrower);
+        if (!loan) { return false; }
+
+        removeLoan(*loan);
+        return true;
+    }
+
+    // Position of the borrower's loan in getBorrowers()
+    optional<size_t> findLoan(const Borrower &borrower) const {
+        for (size_t i = 0; i < borrowers.size(); ++i) {
+            if (borrowers[i].compare(borrower)) { return i; }
+        }
+        return nullopt;
+    }
+
+    // Remove a loan by moving the last loan into its place; true if a loan was moved
+    bool removeLoan(size_t loan) {
+        if (borrowers[loan].getCopy() != 0) { copies.checkin(borrowers[loan].getCopy() - 1); }
+        bool moved = loan + 1 != borrowers.size();
+        if (moved) { borrowers[loan] = std::move(borrowers.back()); }
+        borrowers.pop_back();
+        return moved;
+    }
+
+    void setLoanSlot(size_t loan, uint32_t slot) { borrowers[loan].setLoanSlot(slot); }
+
+    // Display book details
+    void displayBookDetails() const {
+        string out;
+        appendBookDetails(out);
+        cout << out;
+    }
+
+    // Append the book details row to a buffer
+    void appendBookDetails(string &out) const {
+        int available = getAvailableCount();
+        appendPadded(out, title, 20);
+        appendPadded(out, author, 20);
+        appendPadded(out, isbn, 15);
+        appendPadded(out, to_string(inventory_count), 15);
+        appendPadded(out, to_string(available), 15);
+        appendPadded(out, available > 0 ? "Available" : "Not Available", 15);
+        out += '\n';
+    }
+
+    // Display borrowers details
+    void displayBorrowersDetails() const {
+        string out;
+        time_t now = time(nullptr);
+        for (const auto &borrower: borrowers) {
+            borrower.appendBorrowerDetails(out, now, borrower.getCopy() != 0 ? barcodeOf(borrower.getCopy()) : "-");
+        }
+        cout << out;
+    }
+};
+
+// ==================== Console Input ====================>
+
+// Input book ISBN
+inline string inputISBN(string message) {
+    string isbn;
+    cout << endl << message;
+    getline(cin, isbn);
+    return isbn;
+}
+
+// Input borrower details
+inline Borrower inputBorrower(string message) {
+    string name, mobile, email;
+
+    cout << endl << message << endl;
+
+    cout << "Enter Name:";
+    getline(cin, name);
+
+    cout << "Enter Mobile:";
+    getline(cin, mobile);
+
+    cout << "Enter Email:";
+    getline(cin, email);
+
+    return Borrower(name, mobile, email);
+}
+
+// Input new book details
+inline Book inputBook() {
+    string title, author, isbn;
+    int inventory_count;
+
+    cout << endl << "Enter Book Title:";
+    getline(cin, title);
+
+    cout << "Enter Author Name:";
+    getline(cin, author);
+
+    cout << "Enter ISBN:";
+    getline(cin, isbn);
+
+    cout << "Enter Inventory Count:";
+    cin >> inventory_count;
+    cin.ignore(); // Clear the input buffer
+
+    return Book(title, author, isbn, inventory_count);
+}
+
+// Page through a listing; fetch_page appends one page to the buffer and returns the next cursor
+inline void displayPaged(const function<string(const string &cursor, string &out)> &fetch_page) {
+    string cursor, out;
+    while (true) {
+        out.clear();
+        cursor = fetch_page(cursor, out);
+        cout << out << flush;
+        if (cursor.empty()) { return; }
+
+        string answer;
+        cout << "-- Press Enter for the next page, or q to stop: ";
+        if (!getline(cin, answer) || answer == "q") { return; }
+    }
+}
+
+// ==================== Page Cursor ====================>
+
+// Continuation token for the ISBN-ordered listing: the last ISBN of the page, hex encoded
+inline string encodeCursor(const string &last_isbn) {
+    static const char digits[] = "0123456789abcdef";
+    string token = "c1.";
+    for (unsigned char c: last_isbn) {
+        token += digits[c >> 4];
+        token += digits[c & 15];
+    }
+    return token;
+}
+
+// Whether a token is empty, for the first page, or one encodeCursor made
+inline bool isValidCursor(const string &token) {
+    return token.empty() || (token.rfind("c1.", 0) == 0 && token.size() % 2 == 1 &&
+                             all_of(token.begin() + 3, token.end(), [](unsigned char c) { return isxdigit(c); }));
+}
+
+// Last ISBN of the previous page, or empty for the first page / an invalid token
+inline string decodeCursor(const string &token) {
+    if (token.empty() || !isValidCursor(token)) { return ""; }
+
+    string isbn;
+    for (size_t i = 3; i < token.size(); i += 2) {
+        isbn += char(stoi(token.substr(i, 2), nullptr, 16));
+    }
+    return isbn;
+}
+
+// ==================== Mutation Class ====================>
+
+// A committed change to the catalog, sequenced by the library that made it
+class Mutation {
+public:
+    enum Type : char { ADD = 'A', DELETE = 'D', BORROW = 'B', RETURN = 'R', COPY_STATE = 'C' };
+
+    uint64_t seq;
+    int64_t commit_ms;
+    Type type;
+    string isbn;
+    string payload; // Book::toString for ADD, Borrower::toString for BORROW/RETURN, "<copy>|<state>" for COPY_STATE
+
+    Mutation(uint64_t seq, int64_t commit_ms, Type type, string isbn, string payload = "") {
+        this->seq = seq;
+        this->commit_ms = commit_ms;
+        this->type = type;
+        this->isbn = isbn;
+        this->payload = payload;
+    }
+
+    // Converts mutation data to string format (tab separated, payload last)
+    string toString() const {
+        return to_string(seq) + "\t" + to_string(commit_ms) + "\t" + string(1, type) + "\t" + isbn + "\t" + payload;
+    }
+
+    // Creates a Mutation object from string data
+    static Mutation fromString(string str) {
+        string seq_str, commit_ms_str, type_str, isbn, payload;
+
+        istringstream ss(str);
+        getline(ss, seq_str, '\t');
+        getline(ss, commit_ms_str, '\t');
+        getline(ss, type_str, '\t');
+        getline(ss, isbn, '\t');
+        getline(ss, payload);
+
+        return Mutation(stoull(seq_str), stoll(commit_ms_str), Type(type_str[0]), isbn, payload);
+    }
+};
+
+// ==================== Catalog Export ====================>
+
+enum class ExportFormat { NDJSON, CSV };
+enum class ExportTable { BOOKS, LOANS };
+
+// Buffered writer that escapes fields straight into a large reusable buffer
+class ExportWriter {
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    int fd;
+    ExportFormat format;
+    vector<char, TrackingAllocator<char, MemorySubsystem::BUFFERS>> buffer;
+    size_t used = 0;
+    size_t total = 0;
+    bool first_field = true;
+    const char *field_name = "";
+    bool failed = false;
+
+    void put(char c) {
+        if (used == buffer.size()) { flush(); }
+        buffer[used++] = c;
+    }
+
+    void put(const char *data, size_t size) {
+        if (used + size > buffer.size()) { flush(); }
+        if (size > buffer.size()) {
+            writeOut(data, size);
+            return;
+        }
+        memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+
+    void put(const string &str) { put(str.data(), str.size()); }
+
+    void writeOut(const char *data, size_t size) {
+        while (size > 0 && !failed) {
+            ssize_t n = ::write(fd, data, size);
+            if (n <= 0) {
+                failed = true;
+                return;
+            }
+            data += n;
+            size -= n;
+            total += n;
+        }
+    }
+
+    // Separator and, for NDJSON, the key of the next field
+    void beginField() {
+        if (format == ExportFormat::CSV) {
+            if (!first_field) { put(','); }
+        } else {
+            put(first_field ? '{' : ',');
+            put('"');
+            put(field_name, strlen(field_name));
+            put("\":", 2);
+        }
+        first_field = false;
+    }
+
+public:
+    ExportWriter(int fd, ExportFormat format) : buffer(BUFFER_SIZE) {
+        this->fd = fd;
+        this->format = format;
+    }
+
+    ~ExportWriter() { flush(); }
+
+    void flush() {
+        writeOut(buffer.data(), used);
+        used = 0;
+    }
+
+    size_t bytesWritten() const { return total + used; }
+    bool ok() const { return !failed; }
+
+    void setFieldName(const char *name) { field_name = name; }
+
+    void text(const string &value) {
+        beginField();
+        if (format == ExportFormat::NDJSON) {
+            put('"');
+            for (unsigned char c: value) {
+                if (c == '"' || c == '\\') {
+                    put('\\');
+                    put(char(c));
+                } else if (c < 0x20) {
+                    static const char digits[] = "0123456789abcdef";
+                    char escaped[6] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 15]};
+                    put(escaped, 6);
+                } else {
+                    put(char(c));
+                }
+            }
+            put('"');
+            return;
+        }
+
+        // RFC 4180: quote fields containing separators, quotes or line breaks, doubling quotes
+        if (value.find_first_of(",\"\r\n") == string::npos) {
+            put(value);
+            return;
+        }
+        put('"');
+        for (char c: value) {
+            if (c == '"') { put('"'); }
+            put(c);
+        }
+        put('"');
+    }
+
+    void number(int64_t value) {
+        beginField();
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        put(digits, result.ptr - digits);
+    }
+
+    void boolean(bool value) {
+        beginField();
+        if (format == ExportFormat::NDJSON) {
+            put(value ? "true" : "false", value ? 4 : 5);
+        } else {
+            put(value ? '1' : '0');
+        }
+    }
+
+    void date(time_t value) {
+        char text[DateFormatter::LENGTH];
+        DateFormatter::format(value, text);
+        beginField();
+        if (format == ExportFormat::NDJSON) { put('"'); }
+        put(text, DateFormatter::LENGTH);
+        if (format == ExportFormat::NDJSON) { put('"'); }
+    }
+
+    void endRow() {
+        if (format == ExportFormat::NDJSON) {
+            if (first_field) { put('{'); }
+            put("}\n", 2);
+        } else {
+            put("\r\n", 2);
+        }
+        first_field = true;
+    }
+
+    // CSV header line with the column names
+    void header(const vector<const char *> &names) {
+        if (format != ExportFormat::CSV) { return; }
+        for (const char *name: names) {
+            text(name);
+        }
+        endRow();
+    }
+};
+
+// Exportable column: a name and how to write it for a book (and loan, for the loans table)
+struct ExportColumn {
+    const char *name;
+    void (*write)(ExportWriter &writer, const Book &book, const Borrower *loan, time_t now);
+};
+
+// Throughput of one export run
+struct ExportStats {
+    size_t rows = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+    bool ok = true;
+
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / 1e6 / seconds : 0; }
+
+    string toString() const {
+        ostringstream oss;
+        oss << fixed << setprecision(2) << "Exported " << rows << " rows (" << bytes / 1e6 << " MB) in "
+                << seconds << " s, " << megabytesPerSecond() << " MB/s";
+        return oss.str();
+    }
+};
+
+// Streams the catalog or the loan table as NDJSON or CSV with a selectable set of columns
+class CatalogExporter {
+    static const vector<ExportColumn> &bookColumns() {
+        static const vector<ExportColumn> columns = {
+            {"title", [](ExportWriter &w, const Book &b, const Borrower *, time_t) { w.text(b.getTitle()); }},
+            {"author", [](ExportWriter &w, const Book &b, const Borrower *, time_t) { w.text(b.getAuthor()); }},
+            {"isbn", [](ExportWriter &w, const Book &b, const Borrower *, time_t) { w.text(b.getISBN()); }},
+            {"inventory", [](ExportWriter &w, const Book &b, const Borrower *, time_t) {
+                w.number(b.getInventoryCount());
+            }},
+            {"borrowed", [](ExportWriter &w, const Book &b, const Borrower *, time_t) {
+                w.number(int64_t(b.getBorrowers().size()));
+            }},
+            {"available", [](ExportWriter &w, const Book &b, const Borrower *, time_t) {
+                w.number(b.getAvailableCount());
+            }},
+        };
+        return columns;
+    }
+
+    static const vector<ExportColumn> &loanColumns() {
+        static const vector<ExportColumn> columns = {
+            {"isbn", [](ExportWriter &w, const Book &b, const Borrower *, time_t) { w.text(b.getISBN()); }},
+            {"title", [](ExportWriter &w, const Book &b, const Borrower *, time_t) { w.text(b.getTitle()); }},
+            {"barcode", [](ExportWriter &w, const Book &b, const Borrower *l, time_t) {
+                w.text(l->getCopy() != 0 ? b.barcodeOf(l->getCopy()) : "");
+            }},
+            {"name", [](ExportWriter &w, const Book &, const Borrower *l, time_t) { w.text(l->getName()); }},
+            {"mobile", [](ExportWriter &w, const Book &, const Borrower *l, time_t) { w.text(l->getMobile()); }},
+            {"email", [](ExportWriter &w, const Book &, const Borrower *l, time_t) { w.text(l->getEmail()); }},
+            {"borrow_date", [](ExportWriter &w, const Book &, const Borrower *l, time_t) {
+                w.date(l->getBorrowDate());
+            }},
+            {"return_date", [](ExportWriter &w, const Book &, const Borrower *l, time_t) {
+                w.date(l->getReturnDate());
+            }},
+            {"overdue", [](ExportWriter &w, const Book &, const Borrower *l, time_t now) {
+                w.boolean(l->isBookOverdue(now));
+            }},
+        };
+        return columns;
+    }
+
+public:
+    static const vector<ExportColumn> &columnsOf(ExportTable table) {
+        return table == ExportTable::BOOKS ? bookColumns() : loanColumns();
+    }
+
+    // Resolve a comma separated column list (empty selects all); returns false on an unknown name
+    static bool selectColumns(ExportTable table, const string &list, vector<const ExportColumn *> &selected) {
+        selected.clear();
+        const vector<ExportColumn> &columns = columnsOf(table);
+        if (list.empty()) {
+            for (const auto &column: columns) {
+                selected.push_back(&column);
+            }
+            return true;
+        }
+
+        istringstream ss(list);
+        string name;
+        while (getline(ss, name, ',')) {
+            auto it = find_if(columns.begin(), columns.end(),
+                              [&](const ExportColumn &column) { return name == column.name; });
+            if (it == columns.end()) { return false; }
+            selected.push_back(&*it);
+        }
+        return !selected.empty();
+    }
+
+    static ExportStats exportTo(int fd, span<const Book> books, ExportTable table, ExportFormat format,
+                                const vector<const ExportColumn *> &columns) {
+        auto start = chrono::steady_clock::now();
+        time_t now = time(nullptr);
+        ExportStats stats;
+
+        vector<const char *> names;
+        for (const auto *column: columns) {
+            names.push_back(column->name);
+        }
+
+        {
+            ExportWriter writer(fd, format);
+            writer.header(names);
+
+            auto writeRow = [&](const Book &book, const Borrower *loan) {
+                for (const auto *column: columns) {
+                    writer.setFieldName(column->name);
+                    column->write(writer, book, loan, now);
+                }
+                writer.endRow();
+                ++stats.rows;
+            };
+
+            for (const auto &book: books) {
+                if (table == ExportTable::BOOKS) {
+                    writeRow(book, nullptr);
+                    continue;
+                }
+                for (const auto &loan: book.getBorrowers()) {
+                    writeRow(book, &loan);
+                }
+            }
+
+            writer.flush();
+            stats.bytes = writer.bytesWritten();
+            stats.ok = writer.ok();
+        }
+
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+
+    // Export to a file path, or standard output for "-"
+    static ExportStats exportTo(const string &path, span<const Book> books, ExportTable table,
+                                ExportFormat format, const vector<const ExportColumn *> &columns) {
+        if (path == "-") { return exportTo(STDOUT_FILENO, books, table, format, columns); }
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            ExportStats stats;
+            stats.ok = false;
+            return stats;
+        }
+
+        ExportStats stats = exportTo(fd, books, table, format, columns);
+        close(fd);
+        return stats;
+    }
+
+    static bool parseTable(const string &name, ExportTable &table) {
+        if (name == "books") {
+            table = ExportTable::BOOKS;
+        } else if (name == "loans") {
+            table = ExportTable::LOANS;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool parseFormat(const string &name, ExportFormat &format) {
+        if (name == "ndjson") {
+            format = ExportFormat::NDJSON;
+        } else if (name == "csv") {
+            format = ExportFormat::CSV;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// ==================== Bulk Import ====================>
+
+// A line of an import file that was not added to the catalog
+struct ImportReject {
+    size_t line;
+    string isbn;
+    string reason;
+};
+
+// Outcome of a bulk import
+struct ImportReport {
+    size_t read = 0;
+    size_t imported = 0;
+    vector<ImportReject> rejects;
+    bool saved = true;
+    double parse_seconds = 0;
+    double total_seconds = 0;
+
+    string toString() const {
+        ostringstream oss;
+        oss << fixed << setprecision(2) << "Read " << read << " lines, imported " << imported << " books, rejected "
+                << rejects.size() << " (parse " << parse_seconds << " s, total " << total_seconds << " s)";
+        return oss.str();
+    }
+};
+
+// Outcome of applying outside edits of the catalog file
+struct ReloadReport {
+    bool changed = false; // the file differed from what this library last loaded or saved
+    size_t read = 0;
+    size_t added = 0;
+    size_t updated = 0;
+    size_t removed = 0;
+    vector<ImportReject> rejects; // while any line is rejected, no record is removed
+
+    string toString() const {
+        ostringstream oss;
+        oss << "Read " << read << " lines: " << added << " added, " << updated << " updated, " << removed << " removed, "
+                << rejects.size() << " rejected";
+        return oss.str();
+    }
+};
+
+// Parses an import file (Book::toString lines) on several threads
+class BulkImporter {
+public:
+    // A parsed line: the book, or the reason it could not be parsed
+    struct ParsedLine {
+        size_t line;
+        optional<Book> book;
+        string error;
+    };
+
+    static vector<ParsedLine> parse(const string &data, unsigned thread_count) {
+        // Split into chunks that end on line boundaries
+        vector<size_t> bounds = {0};
+        for (unsigned i = 1; i < thread_count; ++i) {
+            size_t pos = max(bounds.back(), data.size() * i / thread_count);
+            pos = data.find('\n', pos);
+            if (pos == string::npos) { break; }
+            bounds.push_back(pos + 1);
+        }
+        bounds.push_back(data.size());
+
+        vector<vector<ParsedLine>> chunks(bounds.size() - 1);
+        vector<thread> workers;
+        for (size_t c = 0; c + 1 < bounds.size(); ++c) {
+            workers.emplace_back([&, c] { chunks[c] = parseChunk(data, bounds[c], bounds[c + 1]); });
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+
+        // Number lines in file order
+        vector<ParsedLine> lines;
+        for (auto &chunk: chunks) {
+            for (auto &parsed: chunk) {
+                parsed.line = lines.size() + 1;
+                lines.push_back(std::move(parsed));
+            }
+        }
+        return lines;
+    }
+
+private:
+    static vector<ParsedLine> parseChunk(const string &data, size_t begin, size_t end) {
+        vector<ParsedLine> lines;
+        while (begin < end) {
+            size_t eol = data.find('\n', begin);
+            if (eol == string::npos || eol > end) { eol = end; }
+
+            string line = data.substr(begin, eol - begin);
+            if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+            begin = eol + 1;
+
+            ParsedLine parsed{0, nullopt, ""};
+            try {
+                Book book = Book::fromString(line);
+                if (book.getISBN().empty()) {
+                    parsed.error = "missing ISBN";
+                } else if (!book.loansPlaced()) {
+                    parsed.error = "more borrowers than copies on the shelf";
+                } else {
+                    parsed.book = std::move(book);
+                }
+            } catch (const exception &) {
+                parsed.error = "malformed line";
+            }
+            lines.push_back(std::move(parsed));
+        }
+        return lines;
+    }
+};
+
+// ==================== Query Engine ====================>
+
+// Filter expressions over the catalog, for example:
+//   author ~ "Sharma" and available > 0 and inventory >= 5
+//
+// Fields: title, author, isbn (text); inventory, available, borrowed (numbers).
+// Operators: = != < <= > >= and ~ (text contains); combined with and, or, not and parentheses.
+
+enum class CompareOp { EQ, NE, LT, LE, GT, GE, CONTAINS };
+
+using BookPredicate = function<bool(const Book &)>;
+
+// Comparator for one operator, instantiated per field type
+template<CompareOp Op>
+struct Compare {
+    template<typename T>
+    bool operator()(const T &value, const T &literal) const {
+        if constexpr (Op == CompareOp::EQ) { return value == literal; }
+        if constexpr (Op == CompareOp::NE) { return value != literal; }
+        if constexpr (Op == CompareOp::LT) { return value < literal; }
+        if constexpr (Op == CompareOp::LE) { return value <= literal; }
+        if constexpr (Op == CompareOp::GT) { return value > literal; }
+        if constexpr (Op == CompareOp::GE) { return value >= literal; }
+    }
+};
+
+template<>
+struct Compare<CompareOp::CONTAINS> {
+    bool operator()(const string &value, const string &literal) const {
+        return value.find(literal) != string::npos;
+    }
+};
+
+// A field accessor, a comparator and a literal fused into one predicate
+template<typename Get, typename Cmp, typename T>
+struct FieldPredicate {
+    Get get;
+    Cmp cmp;
+    T literal;
+
+    bool operator()(const Book &book) const { return cmp(get(book), literal); }
+};
+
+// Parsed form of a query expression
+struct QueryNode {
+    enum Kind { AND, OR, NOT, COMPARE };
+
+    Kind kind;
+    vector<unique_ptr<QueryNode>> children;
+    string field;
+    CompareOp op = CompareOp::EQ;
+    string text;
+    int64_t number = 0;
+    bool is_number = false;
+};
+
+// Predicate plus the ISBN range the planner could derive for the ordered ISBN index
+struct CompiledQuery {
+    BookPredicate predicate;
+    optional<string> isbn_lower;
+    bool lower_inclusive = true;
+    optional<string> isbn_upper;
+    bool upper_inclusive = true;
+
+    bool usesIndex() const { return isbn_lower || isbn_upper; }
+
+    // Whether the ISBN bounds contradict each other, as in isbn > "5" and isbn < "3"
+    bool isEmptyRange() const {
+        return isbn_lower && isbn_upper &&
+               (*isbn_lower > *isbn_upper || (*isbn_lower == *isbn_upper && !(lower_inclusive && upper_inclusive)));
+    }
+};
+
+class QueryEngine {
+    // Tokenizer and recursive-descent parser state
+    const string &text;
+    size_t pos = 0;
+    string error;
+
+    explicit QueryEngine(const string &text) : text(text) {}
+
+    void skipSpaces() {
+        while (pos < text.size() && isspace((unsigned char) text[pos])) { ++pos; }
+    }
+
+    bool fail(const string &message) {
+        if (error.empty()) { error = message + " at position " + to_string(pos + 1); }
+        return false;
+    }
+
+    void failCompile(const string &message) {
+        if (error.empty()) { error = message; }
+    }
+
+    // Consume a keyword (case-insensitive) if it comes next as a whole word
+    bool keyword(const string &word) {
+        skipSpaces();
+        if (text.size() - pos < word.size()) { return false; }
+        for (size_t i = 0; i < word.size(); ++i) {
+            if (tolower((unsigned char) text[pos + i]) != word[i]) { return false; }
+        }
+        size_t end = pos + word.size();
+        if (end < text.size() && (isalnum((unsigned char) text[end]) || text[end] == '_')) { return false; }
+        pos = end;
+        return true;
+    }
+
+    bool symbol(char c) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    unique_ptr<QueryNode> parseOr() {
+        auto left = parseAnd();
+        if (!left || !keyword("or")) { return left; }
+
+        auto node = make_unique<QueryNode>();
+        node->kind = QueryNode::OR;
+        node->children.push_back(std::move(left));
+        do {
+            auto right = parseAnd();
+            if (!right) { return nullptr; }
+            node->children.push_back(std::move(right));
+        } while (keyword("or"));
+        return node;
+    }
+
+    unique_ptr<QueryNode> parseAnd() {
+        auto left = parseUnary();
+        if (!left || !keyword("and")) { return left; }
+
+        auto node = make_unique<QueryNode>();
+        node->kind = QueryNode::AND;
+        node->children.push_back(std::move(left));
+        do {
+            auto right = parseUnary();
+            if (!right) { return nullptr; }
+            node->children.push_back(std::move(right));
+        } while (keyword("and"));
+        return node;
+    }
+
+    unique_ptr<QueryNode> parseUnary() {
+        if (keyword("not")) {
+            auto child = parseUnary();
+            if (!child) { return nullptr; }
+            auto node = make_unique<QueryNode>();
+            node->kind = QueryNode::NOT;
+            node->children.push_back(std::move(child));
+            return node;
+        }
+
+        if (symbol('(')) {
+            auto node = parseOr();
+            if (node && !symbol(')')) {
+                fail("expected ')'");
+                return nullptr;
+            }
+            return node;
+        }
+
+        return parseComparison();
+    }
+
+    unique_ptr<QueryNode> parseComparison() {
+        auto node = make_unique<QueryNode>();
+        node->kind = QueryNode::COMPARE;
+
+        skipSpaces();
+        while (pos < text.size() && (isalnum((unsigned char) text[pos]) || text[pos] == '_')) {
+            node->field += char(tolower((unsigned char) text[pos++]));
+        }
+        if (node->field.empty()) {
+            fail("expected a field name");
+            return nullptr;
+        }
+
+        skipSpaces();
+        static const vector<pair<string, CompareOp>> operators = {
+            {"==", CompareOp::EQ}, {"!=", CompareOp::NE}, {"<=", CompareOp::LE}, {">=", CompareOp::GE},
+            {"=", CompareOp::EQ}, {"<", CompareOp::LT}, {">", CompareOp::GT}, {"~", CompareOp::CONTAINS},
+        };
+        auto op = find_if(operators.begin(), operators.end(),
+                          [&](const auto &candidate) { return text.compare(pos, candidate.first.size(), candidate.first) == 0; });
+        if (op == operators.end()) {
+            fail("expected an operator");
+            return nullptr;
+        }
+        node->op = op->second;
+        pos += op->first.size();
+
+        skipSpaces();
+        if (pos < text.size() && text[pos] == '"') {
+            for (++pos; pos < text.size() && text[pos] != '"'; ++pos) {
+                if (text[pos] == '\\' && pos + 1 < text.size()) { ++pos; }
+                node->text += text[pos];
+            }
+            if (pos == text.size()) {
+                fail("unterminated string");
+                return nullptr;
+            }
+            ++pos;
+        } else {
+            size_t start = pos;
+            if (pos < text.size() && text[pos] == '-') { ++pos; }
+            while (pos < text.size() && isdigit((unsigned char) text[pos])) { ++pos; }
+            if (pos == start || text[pos - 1] == '-') {
+                fail("expected a number or a quoted string");
+                return nullptr;
+            }
+            if (from_chars(text.data() + start, text.data() + pos, node->number).ec != errc()) {
+                pos = start;
+                fail("number out of range");
+                return nullptr;
+            }
+            node->is_number = true;
+        }
+        return node;
+    }
+
+    template<typename T, typename Get>
+    static optional<BookPredicate> compareField(Get get, CompareOp op, T literal) {
+        switch (op) {
+            case CompareOp::EQ: return FieldPredicate<Get, Compare<CompareOp::EQ>, T>{get, {}, literal};
+            case CompareOp::NE: return FieldPredicate<Get, Compare<CompareOp::NE>, T>{get, {}, literal};
+            case CompareOp::LT: return FieldPredicate<Get, Compare<CompareOp::LT>, T>{get, {}, literal};
+            case CompareOp::LE: return FieldPredicate<Get, Compare<CompareOp::LE>, T>{get, {}, literal};
+            case CompareOp::GT: return FieldPredicate<Get, Compare<CompareOp::GT>, T>{get, {}, literal};
+            case CompareOp::GE: return FieldPredicate<Get, Compare<CompareOp::GE>, T>{get, {}, literal};
+            case CompareOp::CONTAINS:
+                if constexpr (is_same_v<T, string>) {
+                    return FieldPredicate<Get, Compare<CompareOp::CONTAINS>, T>{get, {}, literal};
+                }
+                return nullopt;
+        }
+        return nullopt;
+    }
+
+    optional<BookPredicate> compileComparison(const QueryNode &node) {
+        optional<BookPredicate> predicate;
+        bool text_field = node.field == "title" || node.field == "author" || node.field == "isbn";
+
+        if (text_field && node.is_number) {
+            failCompile("field '" + node.field + "' needs a quoted string");
+            return nullopt;
+        }
+        if (!text_field && !node.is_number) {
+            failCompile("field '" + node.field + "' needs a number");
+            return nullopt;
+        }
+
+        if (node.field == "title") {
+            predicate = compareField<string>([](const Book &b) -> const string & { return b.getTitle(); }, node.op, node.text);
+        } else if (node.field == "author") {
+            predicate = compareField<string>([](const Book &b) -> const string & { return b.getAuthor(); }, node.op, node.text);
+        } else if (node.field == "isbn") {
+            predicate = compareField<string>([](const Book &b) -> const string & { return b.getISBN(); }, node.op, node.text);
+        } else if (node.field == "inventory") {
+            predicate = compareField<int64_t>([](const Book &b) { return int64_t(b.getInventoryCount()); }, node.op, node.number);
+        } else if (node.field == "available") {
+            predicate = compareField<int64_t>([](const Book &b) { return int64_t(b.getAvailableCount()); }, node.op, node.number);
+        } else if (node.field == "borrowed") {
+            predicate = compareField<int64_t>([](const Book &b) { return int64_t(b.getBorrowers().size()); }, node.op, node.number);
+        } else {
+            failCompile("unknown field '" + node.field + "'");
+            return nullopt;
+        }
+
+        if (!predicate) { failCompile("operator ~ needs a text field"); }
+        return predicate;
+    }
+
+    optional<BookPredicate> compileNode(const QueryNode &node) {
+        if (node.kind == QueryNode::COMPARE) { return compileComparison(node); }
+
+        vector<BookPredicate> children;
+        for (const auto &child: node.children) {
+            optional<BookPredicate> predicate = compileNode(*child);
+            if (!predicate) { return nullopt; }
+            children.push_back(std::move(*predicate));
+        }
+
+        switch (node.kind) {
+            case QueryNode::NOT:
+                return [child = std::move(children[0])](const Book &book) { return !child(book); };
+            case QueryNode::AND:
+                return [children = std::move(children)](const Book &book) {
+                    for (const auto &child: children) {
+                        if (!child(book)) { return false; }
+                    }
+                    return true;
+                };
+            default:
+                return [children = std::move(children)](const Book &book) {
+                    for (const auto &child: children) {
+                        if (child(book)) { return true; }
+                    }
+                    return false;
+                };
+        }
+    }
+
+    // Narrow the ISBN index range from isbn comparisons in the top-level conjunction
+    static void planIndexRange(const QueryNode &root, CompiledQuery &query) {
+        vector<const QueryNode *> terms;
+        if (root.kind == QueryNode::AND) {
+            for (const auto &child: root.children) {
+                terms.push_back(child.get());
+            }
+        } else {
+            terms.push_back(&root);
+        }
+
+        for (const auto *term: terms) {
+            if (term->kind != QueryNode::COMPARE || term->field != "isbn") { continue; }
+
+            bool lower = term->op == CompareOp::EQ || term->op == CompareOp::GT || term->op == CompareOp::GE;
+            bool upper = term->op == CompareOp::EQ || term->op == CompareOp::LT || term->op == CompareOp::LE;
+            // Of two bounds on the same value, the exclusive one is tighter
+            if (lower && (!query.isbn_lower || term->text > *query.isbn_lower ||
+                          (term->text == *query.isbn_lower && term->op == CompareOp::GT))) {
+                query.isbn_lower = term->text;
+                query.lower_inclusive = term->op != CompareOp::GT;
+            }
+            if (upper && (!query.isbn_upper || term->text < *query.isbn_upper ||
+                          (term->text == *query.isbn_upper && term->op == CompareOp::LT))) {
+                query.isbn_upper = term->text;
+                query.upper_inclusive = term->op != CompareOp::LT;
+            }
+        }
+    }
+
+public:
+    // Parse and compile a query expression once; returns nullopt and sets error on failure
+    static optional<CompiledQuery> compile(const string &text, string &error) {
+        QueryEngine engine(text);
+        unique_ptr<QueryNode> root = engine.parseOr();
+        engine.skipSpaces();
+        if (root && engine.pos != text.size()) { engine.fail("unexpected input"); }
+
+        optional<BookPredicate> predicate;
+        if (root && engine.error.empty()) { predicate = engine.compileNode(*root); }
+        if (!predicate) {
+            error = engine.error;
+            return nullopt;
+        }
+
+        CompiledQuery query;
+        query.predicate = std::move(*predicate);
+        planIndexRange(*root, query);
+        return query;
+    }
+
+    // Evaluate a predicate over the books, splitting large catalogs across threads
+    static vector<const Book *> scan(span<const Book> books, const BookPredicate &predicate, unsigned thread_count) {
+        static constexpr size_t MIN_BOOKS_PER_THREAD = 16384;
+        size_t chunks = max<size_t>(1, min<size_t>(thread_count, books.size() / MIN_BOOKS_PER_THREAD));
+
+        vector<vector<const Book *>> results(chunks);
+        auto scanChunk = [&](size_t c) {
+            size_t end = books.size() * (c + 1) / chunks;
+            for (size_t i = books.size() * c / chunks; i < end; ++i) {
+                if (predicate(books[i])) { results[c].push_back(&books[i]); }
+            }
+        };
+
+        vector<thread> workers;
+        for (size_t c = 1; c < chunks; ++c) {
+            workers.emplace_back(scanChunk, c);
+        }
+        scanChunk(0);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+
+        vector<const Book *> matches;
+        for (const auto &result: results) {
+            matches.insert(matches.end(), result.begin(), result.end());
+        }
+        return matches;
+    }
+};
+
+// ==================== Slot Handles ====================>
+
+// Compact reference into a slot map: the slot index and the slot's generation when the handle was
+// issued. Slot maps bump the generation on reuse, so handles to released slots are detected as stale.
+struct SlotHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    uint64_t pack() const { return uint64_t(generation) << 32 | index; }
+    static SlotHandle unpack(uint64_t packed) { return {uint32_t(packed), uint32_t(packed >> 32)}; }
+
+    // "<index>-<generation>", as shown to patrons
+    string toString() const { return to_string(index) + "-" + to_string(generation); }
+
+    static optional<SlotHandle> fromString(const string &str) {
+        SlotHandle handle;
+        const char *end = str.data() + str.size();
+        auto [dash, index_error] = from_chars(str.data(), end, handle.index);
+        if (index_error != errc() || dash == end || *dash != '-') { return nullopt; }
+        auto [last, generation_error] = from_chars(dash + 1, end, handle.generation);
+        if (generation_error != errc() || last != end) { return nullopt; }
+        return handle;
+    }
+};
+
+// An outstanding loan; valid for the lifetime of the Library instance
+using LoanHandle = SlotHandle;
+
+// A hold waiting in a title's queue
+using HoldHandle = SlotHandle;
+
+// ==================== Hold Queues ====================>
+
+// Per-ISBN FIFO queues of patrons waiting for a copy.
+//
+// Holds live in a slot map and are linked into a doubly linked list per title, so placing,
+// cancelling and taking the next hold are O(1) however long the queue is. Expired holds are
+// dropped when they reach the front of their queue.
+class HoldQueues {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Hold {
+        uint32_t generation = 0; // odd while the hold is queued
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+        time_t expires = 0;
+        string isbn;
+        Borrower patron = Borrower("", "", "", 0, 0);
+    };
+
+    struct Queue {
+        uint32_t head = NONE;
+        uint32_t tail = NONE;
+        size_t size = 0;
+    };
+
+    vector<Hold> holds;
+    vector<uint32_t> free_holds;
+    unordered_map<string, Queue> queues;
+
+    void unlink(uint32_t index) {
+        Hold &hold = holds[index];
+        auto it = queues.find(hold.isbn);
+        Queue &queue = it->second;
+        (hold.prev == NONE ? queue.head : holds[hold.prev].next) = hold.next;
+        (hold.next == NONE ? queue.tail : holds[hold.next].prev) = hold.prev;
+        if (--queue.size == 0) { queues.erase(it); }
+
+        ++hold.generation;
+        free_holds.push_back(index);
+    }
+
+    bool isQueued(HoldHandle handle) const {
+        return handle.index < holds.size() && (handle.generation & 1) && holds[handle.index].generation == handle.generation;
+    }
+
+public:
+    // Queue a patron for a title until `expires`
+    HoldHandle place(const string &isbn, const Borrower &patron, time_t expires) {
+        uint32_t index;
+        if (free_holds.empty()) {
+            index = uint32_t(holds.size());
+            holds.emplace_back();
+        } else {
+            index = free_holds.back();
+            free_holds.pop_back();
+        }
+
+        Queue &queue = queues[isbn];
+        Hold &hold = holds[index];
+        ++hold.generation;
+        hold.isbn = isbn;
+        hold.patron = patron;
+        hold.expires = expires;
+        hold.prev = queue.tail;
+        hold.next = NONE;
+        (queue.tail == NONE ? queue.head : holds[queue.tail].next) = index;
+        queue.tail = index;
+        ++queue.size;
+        return {index, hold.generation};
+    }
+
+    bool cancel(HoldHandle handle) {
+        if (!isQueued(handle)) { return false; }
+
+        unlink(handle.index);
+        return true;
+    }
+
+    // The first unexpired hold for a title, dropping expired ones ahead of it; the hold stays
+    // queued until it is cancelled
+    optional<HoldHandle> peekNext(const string &isbn, time_t now) {
+        auto it = queues.find(isbn);
+        while (it != queues.end()) {
+            uint32_t index = it->second.head;
+            if (holds[index].expires >= now) { return HoldHandle{index, holds[index].generation}; }
+
+            unlink(index);
+            it = queues.find(isbn);
+        }
+        return nullopt;
+    }
+
+    // Holds queued for a title, including expired ones not yet dropped
+    size_t queueLength(const string &isbn) const {
+        auto it = queues.find(isbn);
+        return it == queues.end() ? 0 : it->second.size;
+    }
+
+    // The title and patron of a queued hold, or nullptr for a stale handle
+    pair<const string *, const Borrower *> find(HoldHandle handle) const {
+        if (!isQueued(handle)) { return {nullptr, nullptr}; }
+        return {&holds[handle.index].isbn, &holds[handle.index].patron};
+    }
+
+    // Drop every hold for a title
+    void drop(const string &isbn) {
+        while (queues.count(isbn)) {
+            unlink(queues[isbn].head);
+        }
+    }
+};
+
+// ==================== Library Class ====================>
+
+// Result of a library operation; IO_ERROR means the change was applied in memory but could not be saved.
+// INVALID_REQUEST and UNREACHABLE come from remote catalogs: a request that could not be parsed, and
+// a worker that no longer answers. HOLDS_DISABLED refuses a hold on a catalog that cannot serve one.
+enum class LibraryStatus {
+    OK, NOT_FOUND, ALREADY_EXISTS, HAS_BORROWERS, UNAVAILABLE, NOT_BORROWED, IO_ERROR, STALE_HANDLE, AVAILABLE,
+    INVALID_REQUEST, UNREACHABLE, HOLDS_DISABLED
+};
+
+class Library {
+    vector<Book, TrackingAllocator<Book, MemorySubsystem::BOOKS>> books;
+    // ISBN -> position in books, kept in ISBN order for paging
+    map<string, size_t, less<>, TrackingAllocator<pair<const string, size_t>, MemorySubsystem::INDEX>> isbn_index;
+    string filename;
+    uint64_t last_seq = 0;
+    vector<function<void(const Mutation &)>> mutation_listeners;
+
+    // Loan map: one slot per outstanding loan, addressed by LoanHandle. The generation is odd while
+    // the slot holds a loan and is bumped on every acquire and release, so old handles go stale.
+    // Slots start at a random even generation, so a handle issued before a restart or by another
+    // process sharing the catalog does not name a loan of this one.
+    struct LoanSlot {
+        uint32_t generation = 0;
+        uint32_t book = 0; // position in books
+        uint32_t loan = 0; // position in the book's borrowers
+    };
+
+    vector<LoanSlot> loan_slots;
+    vector<uint32_t> free_loan_slots;
+    uint32_t first_generation = uint32_t(random_device()()) & ~1u;
+
+    HoldQueues holds;
+    bool holds_enabled = true;
+
+    // Device, inode, size and modification time of the catalog file when this library last loaded
+    // or saved it, to tell outside edits from its own saves
+    using FileStamp = tuple<dev_t, ino_t, off_t, int64_t>;
+    mutable FileStamp file_stamp{};
+
+    // Lock held around each catalog operation while the catalog is shared with other processes;
+    // taking it may bring in their changes. Nested operations share the outermost hold.
+    mutable function<void()> lock_catalog, unlock_catalog;
+    mutable int catalog_depth = 0;
+
+    class CatalogGuard {
+        const Library &library;
+
+    public:
+        explicit CatalogGuard(const Library &library) : library(library) {
+            if (library.catalog_depth++ == 0 && library.lock_catalog) { library.lock_catalog(); }
+        }
+
+        ~CatalogGuard() {
+            if (--library.catalog_depth == 0 && library.unlock_catalog) { library.unlock_catalog(); }
+        }
+    };
+
+    static FileStamp stampOf(const string &path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) { return {}; }
+        return {st.st_dev, st.st_ino, st.st_size, int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+    }
+
+    // Save books to file
+    bool saveBooksToFile() const {
+        if (filename.empty()) { return true; }
+        bool saved = saveBooksToFile(filename);
+        file_stamp = stampOf(filename);
+        return saved;
+    }
+
+    // Load books from file
+    void loadBooksFromFile() {
+        if (filename.empty()) { return; }
+
+        LatencyTimer timer(LatencyMetric::LOAD);
+        file_stamp = stampOf(filename);
+        BufferString data;
+        {
+            LatencyTimer read_timer(LatencyMetric::LOAD_READ);
+            ifstream inFile(filename, ios::binary);
+            if (!inFile) { return; }
+            data.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        }
+
+        {
+            LatencyTimer parse_timer(LatencyMetric::LOAD_PARSE);
+            books.clear();
+            for (size_t begin = 0; begin < data.size();) {
+                size_t end = min(data.find('\n', begin), data.size());
+                books.push_back(Book::fromString(string(data, begin, end - begin)));
+                begin = end + 1;
+            }
+        }
+
+        LatencyTimer index_timer(LatencyMetric::LOAD_INDEX);
+        rebuildIndex();
+    }
+
+    // Rebuild the ISBN index and the loan map from books
+    void rebuildIndex() {
+        isbn_index.clear();
+        for (uint32_t i = 0; i < loan_slots.size(); ++i) {
+            if (loan_slots[i].generation & 1) { releaseLoanSlot(i); }
+        }
+        for (size_t i = 0; i < books.size(); ++i) {
+            isbn_index[books[i].getISBN()] = i;
+            acquireLoanSlots(i);
+        }
+    }
+
+    // Append a book and index it
+    void insertBook(Book book) {
+        isbn_index[book.getISBN()] = books.size();
+        books.push_back(std::move(book));
+        acquireLoanSlots(books.size() - 1);
+    }
+
+    // Remove a book by moving the last book into its place
+    void eraseBook(Book *book) {
+        size_t position = book - books.data();
+        for (const auto &borrower: book->getBorrowers()) {
+            releaseLoanSlot(borrower.getLoanSlot());
+        }
+        isbn_index.erase(book->getISBN());
+        if (position + 1 != books.size()) {
+            books[position] = std::move(books.back());
+            isbn_index[books[position].getISBN()] = position;
+            for (const auto &borrower: books[position].getBorrowers()) {
+                loan_slots[borrower.getLoanSlot()].book = uint32_t(position);
+            }
+        }
+        books.pop_back();
+    }
+
+    LoanHandle acquireLoanSlot(size_t position, size_t loan) {
+        uint32_t index;
+        if (free_loan_slots.empty()) {
+            index = uint32_t(loan_slots.size());
+            loan_slots.push_back({first_generation});
+        } else {
+            index = free_loan_slots.back();
+            free_loan_slots.pop_back();
+        }
+
+        LoanSlot &slot = loan_slots[index];
+        ++slot.generation;
+        slot.book = uint32_t(position);
+        slot.loan = uint32_t(loan);
+        books[position].setLoanSlot(loan, index);
+        return {index, slot.generation};
+    }
+
+    void releaseLoanSlot(uint32_t index) {
+        ++loan_slots[index].generation;
+        free_loan_slots.push_back(index);
+    }
+
+    // Give every loan of the book at position a slot
+    void acquireLoanSlots(size_t position) {
+        for (size_t loan = 0; loan < books[position].getBorrowers().size(); ++loan) {
+            acquireLoanSlot(position, loan);
+        }
+    }
+
+    // Lend a copy of the book and give the loan a slot
+    bool lend(Book *book, const Borrower &borrower, LoanHandle *handle = nullptr) {
+        if (!book->borrowBook(borrower)) { return false; }
+
+        LoanHandle issued = acquireLoanSlot(book - books.data(), book->getBorrowers().size() - 1);
+        if (handle) { *handle = issued; }
+        return true;
+    }
+
+    // Remove a loan of the book at position, repointing the slot of the loan moved into its place
+    void removeLoan(size_t position, size_t loan) {
+        Book &book = books[position];
+        releaseLoanSlot(book.getBorrowers()[loan].getLoanSlot());
+        if (book.removeLoan(loan)) { loan_slots[book.getBorrowers()[loan].getLoanSlot()].loan = uint32_t(loan); }
+    }
+
+    // Take back a borrower's loan of the book, found by comparing borrower details
+    bool takeBack(Book *book, const Borrower &borrower) {
+        optional<size_t> loan = book->findLoan(borrower);
+        if (!loan) { return false; }
+
+        removeLoan(book - books.data(), *loan);
+        return true;
+    }
+
+    // Bring the book at position in line with an edited record of the same ISBN. When only the loans
+    // differ, loans missing from the record are returned and new ones lent, each published as a
+    // RETURN or BORROW; any other edit replaces the record, published as DELETE then ADD.
+    void applyEditedRecord(size_t position, Book edited) {
+        Book &book = books[position];
+        auto fieldsOf = [](const string &line) {
+            size_t end = 0;
+            for (int field = 0; field < 4 && end != string::npos; ++field) {
+                end = line.find(',', end + (field > 0));
+            }
+            return line.substr(0, end);
+        };
+
+        string line = edited.toString();
+        if (fieldsOf(line) == fieldsOf(book.toString())) {
+            multiset<string> kept;
+            for (const auto &borrower: edited.getBorrowers()) {
+                kept.insert(borrower.toString());
+            }
+            for (size_t loan = book.getBorrowers().size(); loan-- > 0;) {
+                string payload = book.getBorrowers()[loan].toString();
+                auto it = kept.find(payload);
+                if (it != kept.end()) {
+                    kept.erase(it);
+                    continue;
+                }
+                removeLoan(position, loan);
+                publishMutation(Mutation::RETURN, book.getISBN(), payload);
+            }
+
+            bool lent = true;
+            for (const auto &payload: kept) {
+                if (!(lent = lend(&book, Borrower::fromString(payload)))) { break; }
+                publishMutation(Mutation::BORROW, book.getISBN(), book.getBorrowers().back().toString());
+            }
+            if (lent) { return; }
+        }
+
+        for (const auto &borrower: book.getBorrowers()) {
+            releaseLoanSlot(borrower.getLoanSlot());
+        }
+        book = std::move(edited);
+        acquireLoanSlots(position);
+        publishMutation(Mutation::DELETE, book.getISBN());
+        publishMutation(Mutation::ADD, book.getISBN(), book.toString());
+    }
+
+    // Lend the freed copy to the next waiter, then save and publish the return and any hand-off
+    LibraryStatus commitReturn(Book *book, const string &payload, optional<LoanHandle> *handed_off) {
+        optional<LoanHandle> handle = handOff(book);
+
+        bool saved = saveBooksToFile();
+        publishMutation(Mutation::RETURN, book->getISBN(), payload);
+        if (handle) { publishMutation(Mutation::BORROW, book->getISBN(), book->getBorrowers().back().toString()); }
+        if (handed_off) { *handed_off = handle; }
+        return saved ? LibraryStatus::OK : LibraryStatus::IO_ERROR;
+    }
+
+    // Lend a copy back on the shelf to the next patron waiting for the title. The hold leaves the
+    // queue only once the loan is made; the caller publishes it as the book's last borrower.
+    optional<LoanHandle> handOff(Book *book) {
+        optional<HoldHandle> hold = holds.peekNext(book->getISBN(), time(nullptr));
+        if (!hold) { return nullopt; }
+
+        const Borrower *patron = holds.find(*hold).second;
+        LoanHandle handle;
+        if (!lend(book, Borrower(patron->getName(), patron->getMobile(), patron->getEmail()), &handle)) { return nullopt; }
+        holds.cancel(*hold);
+        return handle;
+    }
+
+    bool isLive(LoanHandle handle) const {
+        return handle.index < loan_slots.size() && (handle.generation & 1) &&
+               loan_slots[handle.index].generation == handle.generation;
+    }
+
+    // Find a book by ISBN
+    Book *findBook(string_view isbn) {
+        auto it = isbn_index.find(isbn);
+        return it == isbn_index.end() ? nullptr : &books[it->second];
+    }
+
+public:
+    // Find a book by ISBN without copying it
+    const Book *findBook(string_view isbn) const {
+        auto it = isbn_index.find(isbn);
+        return it == isbn_index.end() ? nullptr : &books[it->second];
+    }
+
+    // Save books to the given file
+    bool saveBooksToFile(const string &path) const {
+        LatencyTimer timer(LatencyMetric::SAVE);
+        BufferString data;
+        {
+            LatencyTimer serialize_timer(LatencyMetric::SAVE_SERIALIZE);
+            for (const auto &book: books) {
+                data += book.toString();
+                data += '\n';
+            }
+        }
+
+        ofstream outFile(path, ios::binary);
+        if (!outFile) { return false; }
+
+        {
+            LatencyTimer write_timer(LatencyMetric::SAVE_WRITE);
+            outFile.write(data.data(), streamsize(data.size()));
+        }
+
+        LatencyTimer flush_timer(LatencyMetric::SAVE_FLUSH);
+        outFile.close();
+        return bool(outFile);
+    }
+
+private:
+
+    // Sequence a committed mutation and hand it to the listeners
+    void publishMutation(Mutation::Type type, const string &isbn, const string &payload = "") {
+        Mutation mutation(++last_seq, currentTimeMillis(), type, isbn, payload);
+        for (const auto &listener: mutation_listeners) {
+            listener(mutation);
+        }
+    }
+
+public:
+    // Constructor (an empty filename keeps the catalog in memory only)
+    explicit Library(string filename = "library_books.csv") {
+        this->filename = filename;
+
+        // Load saved books from file
+        loadBooksFromFile();
+    }
+
+    // Catalog file, empty when the catalog is in memory only
+    const string &getFilename() const { return filename; }
+
+    // Take `lock` before and `unlock` after each catalog operation, outside console input
+    void setCatalogLock(function<void()> lock, function<void()> unlock) {
+        lock_catalog = std::move(lock);
+        unlock_catalog = std::move(unlock);
+    }
+
+    // Register a callback for every committed mutation
+    void addMutationListener(function<void(const Mutation &)> listener) {
+        mutation_listeners.push_back(listener);
+    }
+
+    // Sequence number of the last committed mutation
+    uint64_t getLastSeq() const { return last_seq; }
+
+    // Current catalog as Book::toString lines
+    vector<string> snapshot() const {
+        CatalogGuard guard(*this);
+        vector<string> lines;
+        lines.reserve(books.size());
+        for (const auto &book: books) {
+            lines.push_back(book.toString());
+        }
+        return lines;
+    }
+
+    // Replace the catalog with snapshot lines taken at the given sequence number
+    void loadSnapshot(const vector<string> &lines, uint64_t seq) {
+        books.clear();
+        for (const auto &line: lines) {
+            books.push_back(Book::fromString(line));
+        }
+        rebuildIndex();
+        last_seq = seq;
+    }
+
+    // Apply a mutation committed elsewhere, keeping its sequence number
+    bool applyMutation(const Mutation &mutation) {
+        bool applied = false;
+        Book *book = findBook(mutation.isbn);
+
+        switch (mutation.type) {
+            case Mutation::ADD:
+                if (!book) {
+                    insertBook(Book::fromString(mutation.payload));
+                    applied = true;
+                }
+                break;
+            case Mutation::DELETE:
+                if (book) {
+                    eraseBook(book);
+                    applied = true;
+                }
+                break;
+            case Mutation::BORROW:
+                applied = book && lend(book, Borrower::fromString(mutation.payload));
+                break;
+            case Mutation::RETURN:
+                applied = book && takeBack(book, Borrower::fromString(mutation.payload));
+                break;
+            case Mutation::COPY_STATE: {
+                size_t bar = mutation.payload.find('|');
+                applied = book && bar != string::npos &&
+                          book->setCopyState(uint32_t(stoul(mutation.payload)), CopyState(stoi(mutation.payload.substr(bar + 1))));
+                break;
+            }
+        }
+
+        last_seq = mutation.seq;
+        for (const auto &listener: mutation_listeners) {
+            listener(mutation);
+        }
+        return applied;
+    }
+
+    // Add a book to library
+    LibraryStatus addBook(const Book &book) {
+        LatencyTimer timer(LatencyMetric::ADD);
+        CatalogGuard guard(*this);
+        if (findBook(book.getISBN())) { return LibraryStatus::ALREADY_EXISTS; }
+
+        insertBook(book);
+        bool saved = saveBooksToFile();
+        publishMutation(Mutation::ADD, book.getISBN(), book.toString());
+        return saved ? LibraryStatus::OK : LibraryStatus::IO_ERROR;
+    }
+
+    // Add a book to library (interactive)
+    void addBook() {
+        Book book = inputBook();
+
+        switch (addBook(book)) {
+            case LibraryStatus::ALREADY_EXISTS:
+                cout << "Book with ISBN " << book.getISBN() << " already exists in the library." << endl;
+                return;
+            case LibraryStatus::IO_ERROR:
+                cerr << "Error: Unable to open file for writing." << endl;
+                break;
+            default:
+                break;
+        }
+
+        cout << endl << "Book '" << book.getTitle() << "' added successfully!" << endl;
+    }
+
+    // Delete a book from library
+    LibraryStatus deleteBook(const string &isbn) {
+        LatencyTimer timer(LatencyMetric::DELETE);
+        CatalogGuard guard(*this);
+        Book *book = findBook(isbn);
+        if (!book) { return LibraryStatus::NOT_FOUND; }
+        if (book->getBorrowers().size() > 0) { return LibraryStatus::HAS_BORROWERS; }
+
+        holds.drop(isbn);
+        eraseBook(book);
+        bool saved = saveBooksToFile();
+        publishMutation(Mutation::DELETE, isbn);
+        return saved ? LibraryStatus::OK : LibraryStatus::IO_ERROR;
+    }
+
+    // Delete a book from library (interactive)
+    void deleteBook() {
+        string isbn = inputISBN("Enter ISBN of the book to delete:");
+
+        switch (deleteBook(isbn)) {
+            case LibraryStatus::OK:
+                cout << "Book with ISBN " << isbn << " deleted successfully." << endl;
+                break;
+            case LibraryStatus::HAS_BORROWERS:
+                cout << "Book with ISBN " << isbn << " has been borrowed and cannot be deleted." << endl;
+                break;
+            case LibraryStatus::IO_ERROR:
+                cerr << "Error: Unable to open file for writing." << endl;
+                cout << "Book with ISBN " << isbn << " deleted successfully." << endl;
+                break;
+            default:
+                cout << "Book with ISBN " << isbn << " not found in the library." << endl;
+        }
+    }
+
+    // Display all books in library, one page at a time
+    void displayBooks(size_t page_size = 20) {
+        if (getBooksCount() == 0) {
+            cout << endl << "No books in the library." << endl;
+            return;
+        }
+
+        displayPaged([&](const string &cursor, string &out) {
+            return appendBooksPage(cursor, page_size, out);
+        });
+    }
+
+    // Books after the cursor in ISBN order; costs O(log n + page size) at any depth
+    vector<const Book *> getBooksPage(const string &cursor, size_t page_size, string &next_cursor) const {
+        CatalogGuard guard(*this);
+        vector<const Book *> page;
+        string after = decodeCursor(cursor);
+        auto it = after.empty() ? isbn_index.begin() : isbn_index.upper_bound(after);
+
+        for (; it != isbn_index.end() && page.size() < page_size; ++it) {
+            page.push_back(&books[it->second]);
+        }
+
+        next_cursor = it != isbn_index.end() && !page.empty() ? encodeCursor(page.back()->getISBN()) : "";
+        return page;
+    }
+
+    // Append one page of the catalog table to a buffer and return the next cursor
+    string appendBooksPage(const string &cursor, size_t page_size, string &out) const {
+        string next_cursor;
+        vector<const Book *> page = getBooksPage(cursor, page_size, next_cursor);
+
+        appendBookHeader(out);
+        for (const auto *book: page) {
+            book->appendBookDetails(out);
+        }
+        return next_cursor;
+    }
+
+    // Display the catalog table header
+    static void displayBookHeader() {
+        string out;
+        appendBookHeader(out);
+        cout << out;
+    }
+
+    // Append the catalog table header to a buffer
+    static void appendBookHeader(string &out) {
+        out += "\nLibrary Book Catalog:\n\n";
+        appendPadded(out, "Title", 20);
+        appendPadded(out, "Author", 20);
+        appendPadded(out, "ISBN", 15);
+        appendPadded(out, "Inventory", 15);
+        appendPadded(out, "Available", 15);
+        appendPadded(out, "Status", 15);
+        out += '\n';
+        out.append(100, '-');
+        out += '\n';
+    }
+
+    // Total books in library
+    size_t getBooksCount() const {
+        CatalogGuard guard(*this);
+        return books.size();
+    }
+
+    // Display total books in library
+    void displayTotalBooksCount() {
+        cout << endl << "Total books in library: " << getBooksCount() << endl;
+    }
+
+    // Get a copy of the book with the given ISBN
+    optional<Book> getBook(const string &isbn) {
+        CatalogGuard guard(*this);
+        Book *book = findBook(isbn);
+        if (!book) { return nullopt; }
+        return *book;
+    }
+
+    // Books whose title or author contains the given text
+    vector<Book> searchBooks(const string &text) const {
+        CatalogGuard guard(*this);
+        vector<Book> results;
+        for (const auto &book: books) {
+            if (book.getTitle().find(text) != string::npos || book.getAuthor().find(text) != string::npos) {
+                results.push_back(book);
+            }
+        }
+        return results;
+    }
+
+    // Search books by title or author (interactive)
+    void searchBooks() {
+        string text;
+        cout << endl << "Enter text to search in titles and authors:";
+        getline(cin, text);
+
+        vector<Book> results = searchBooks(text);
+        if (results.empty()) {
+            cout << endl << "No books match '" << text << "'." << endl;
+            return;
+        }
+
+        displayBookHeader();
+        for (const auto &book: results) {
+            book.displayBookDetails();
+        }
+    }
+
+    // All books in library
+    span<const Book> getBooks() const { return books; }
+
+    // Books matching a compiled query, read from the ISBN index when the query bounds the ISBN
+    vector<const Book *> queryBooks(const CompiledQuery &query,
+                                    unsigned thread_count = max(1u, thread::hardware_concurrency())) const {
+        CatalogGuard guard(*this);
+        if (!query.usesIndex()) { return QueryEngine::scan(books, query.predicate, thread_count); }
+        if (query.isEmptyRange()) { return {}; }
+
+        auto it = isbn_index.begin();
+        if (query.isbn_lower) {
+            it = query.lower_inclusive ? isbn_index.lower_bound(*query.isbn_lower) : isbn_index.upper_bound(*query.isbn_lower);
+        }
+        auto end = isbn_index.end();
+        if (query.isbn_upper) {
+            end = query.upper_inclusive ? isbn_index.upper_bound(*query.isbn_upper) : isbn_index.lower_bound(*query.isbn_upper);
+        }
+
+        vector<const Book *> matches;
+        for (; it != end; ++it) {
+            if (query.predicate(books[it->second])) { matches.push_back(&books[it->second]); }
+        }
+        return matches;
+    }
+
+    // Query books with a filter expression (interactive)
+    void queryBooks() {
+        string text, error;
+        cout << endl << "Enter Query (e.g. author ~ \"Sharma\" and available > 0):";
+        getline(cin, text);
+
+        optional<CompiledQuery> query = QueryEngine::compile(text, error);
+        if (!query) {
+            cout << "Invalid query: " << error << endl;
+            return;
+        }
+
+        vector<const Book *> matches = queryBooks(*query);
+        if (matches.empty()) {
+            cout << endl << "No books match the query." << endl;
+            return;
+        }
+
+        displayPaged([&](const string &cursor, string &out) {
+            size_t offset = cursor.empty() ? 0 : stoull(cursor);
+            size_t end = min(matches.size(), offset + 20);
+
+            appendBookHeader(out);
+            for (size_t i = offset; i < end; ++i) {
+                matches[i]->appendBookDetails(out);
+            }
+            out += to_string(end) + " of " + to_string(matches.size()) + " matching books\n";
+            return end < matches.size() ? to_string(end) : "";
+        });
+    }
+
+    // Add every new book of an import file, saving the catalog once at the end
+    ImportReport importBooks(const string &path, unsigned thread_count = max(1u, thread::hardware_concurrency())) {
+        auto start = chrono::steady_clock::now();
+        CatalogGuard guard(*this);
+        ImportReport report;
+
+        ifstream inFile(path, ios::binary);
+        if (!inFile) {
+            report.rejects.push_back({0, "", "unable to open " + path});
+            return report;
+        }
+        string data((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+
+        vector<BulkImporter::ParsedLine> lines = BulkImporter::parse(data, thread_count);
+        report.read = lines.size();
+        report.parse_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // One pass: reject ISBNs already in the catalog or seen earlier in the file
+        unordered_set<string> seen;
+        seen.reserve(lines.size());
+        books.reserve(books.size() + lines.size());
+        size_t first_new = books.size();
+        for (auto &parsed: lines) {
+            if (!parsed.book) {
+                report.rejects.push_back({parsed.line, "", parsed.error});
+                continue;
+            }
+
+            const string &isbn = parsed.book->getISBN();
+            if (!seen.insert(isbn).second) {
+                report.rejects.push_back({parsed.line, isbn, "duplicate ISBN in import file"});
+            } else if (isbn_index.count(isbn)) {
+                report.rejects.push_back({parsed.line, isbn, "ISBN already in catalog"});
+            } else {
+                insertBook(std::move(*parsed.book));
+            }
+        }
+        report.imported = books.size() - first_new;
+
+        if (report.imported > 0) {
+            report.saved = saveBooksToFile();
+            for (size_t i = first_new; i < books.size(); ++i) {
+                publishMutation(Mutation::ADD, books[i].getISBN(), books[i].toString());
+            }
+        }
+
+        report.total_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    // Apply edits made to the catalog file by other programs, touching only the records that differ:
+    // new ISBNs are added, edited records updated and ISBNs no longer in the file removed, each
+    // published as mutations. Nothing is read when the file is as this library last loaded or saved
+    // it, and the file is not rewritten.
+    ReloadReport reloadChangedRecords(unsigned thread_count = max(1u, thread::hardware_concurrency())) {
+        CatalogGuard guard(*this);
+        ReloadReport report;
+        if (filename.empty()) { return report; }
+        FileStamp stamp = stampOf(filename);
+        if (stamp == file_stamp) { return report; }
+
+        LatencyTimer timer(LatencyMetric::RELOAD);
+        ifstream inFile(filename, ios::binary);
+        if (!inFile) { return report; } // moved away; the next file written in its place is applied
+        string data((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+        file_stamp = stamp;
+        report.changed = true;
+
+        vector<BulkImporter::ParsedLine> lines = BulkImporter::parse(data, thread_count);
+        report.read = lines.size();
+        unordered_set<string> seen;
+        seen.reserve(lines.size());
+        for (auto &parsed: lines) {
+            if (!parsed.book) {
+                report.rejects.push_back({parsed.line, "", parsed.error});
+                continue;
+            }
+
+            string isbn = parsed.book->getISBN();
+            if (!seen.insert(isbn).second) {
+                report.rejects.push_back({parsed.line, isbn, "duplicate ISBN in catalog file"});
+            } else if (Book *book = findBook(isbn); !book) {
+                insertBook(std::move(*parsed.book));
+                publishMutation(Mutation::ADD, isbn, books.back().toString());
+                ++report.added;
+            } else if (book->toString() != parsed.book->toString()) {
+                applyEditedRecord(book - books.data(), std::move(*parsed.book));
+                ++report.updated;
+            }
+        }
+
+        // A line that could not be read may be any record, so removals wait for a clean file
+        if (report.rejects.empty()) {
+            vector<string> gone;
+            for (const auto &book: books) {
+                if (!seen.count(book.getISBN())) { gone.push_back(book.getISBN()); }
+            }
+            for (const auto &isbn: gone) {
+                holds.drop(isbn);
+                eraseBook(findBook(isbn));
+                publishMutation(Mutation::DELETE, isbn);
+            }
+            report.removed = gone.size();
+        }
+        return report;
+    }
+
+    // Bulk import books from a file (interactive)
+    void importBooks() {
+        string path;
+        cout << endl << "Enter Import File:";
+        getline(cin, path);
+
+        displayImportReport(importBooks(path));
+    }
+
+    // Display an import report, listing the first rejects
+    static void displayImportReport(const ImportReport &report) {
+        if (!report.saved) { cerr << "Error: Unable to open file for writing." << endl; }
+        cout << endl << report.toString() << endl;
+        displayRejects(report.rejects);
+    }
+
+    // Display the first rejected lines of an import or reload
+    static void displayRejects(const vector<ImportReject> &rejects) {
+        for (size_t i = 0; i < rejects.size() && i < 20; ++i) {
+            const ImportReject &reject = rejects[i];
+            cout << "  line " << reject.line << (reject.isbn.empty() ? "" : " (ISBN " + reject.isbn + ")") << ": "
+                    << reject.reason << endl;
+        }
+        if (rejects.size() > 20) {
+            cout << "  ... and " << rejects.size() - 20 << " more" << endl;
+        }
+    }
+
+    // Export the catalog or loan table (interactive)
+    void exportBooks() {
+        string table_name, format_name, column_list, path;
+        ExportTable table;
+        ExportFormat format;
+        vector<const ExportColumn *> columns;
+
+        cout << endl << "Enter Table (books/loans):";
+        getline(cin, table_name);
+
+        cout << "Enter Format (ndjson/csv):";
+        getline(cin, format_name);
+
+        cout << "Enter Columns (comma separated, empty for all):";
+        getline(cin, column_list);
+
+        cout << "Enter Output File:";
+        getline(cin, path);
+
+        if (!CatalogExporter::parseTable(table_name, table) || !CatalogExporter::parseFormat(format_name, format) ||
+            !CatalogExporter::selectColumns(table, column_list, columns)) {
+            cout << "Invalid export options. Please try again." << endl;
+            return;
+        }
+
+        ExportStats stats;
+        {
+            CatalogGuard guard(*this);
+            stats = CatalogExporter::exportTo(path, books, table, format, columns);
+        }
+        if (!stats.ok) {
+            cout << "Error: Unable to write " << path << "." << endl;
+            return;
+        }
+        cout << endl << stats.toString() << endl;
+    }
+
+    // Borrow a book; the loan's handle is stored in `handle` when given
+    LibraryStatus borrowBook(const string &isbn, const Borrower &borrower, LoanHandle *handle = nullptr) {
+        LatencyTimer timer(LatencyMetric::BORROW);
+        CatalogGuard guard(*this);
+        Book *book = findBook(isbn);
+        if (!book) { return LibraryStatus::NOT_FOUND; }
+        if (!lend(book, borrower, handle)) { return LibraryStatus::UNAVAILABLE; }
+
+        bool saved = saveBooksToFile();
+        publishMutation(Mutation::BORROW, isbn, book->getBorrowers().back().toString());
+        return saved ? LibraryStatus::OK : LibraryStatus::IO_ERROR;
+    }
+
+    // Borrow a book (interactive)
+    void borrowBook() {
+        string isbn = inputISBN("Enter ISBN of the book to borrow:");
+        if (!getBook(isbn)) {
+            cout << "Something went wrong. Please try again.";
+            return;
+        }
+
+        Borrower borrower = inputBorrower("Enter Borrower Details:");
+        LoanHandle handle;
+        switch (borrowBook(isbn, borrower, &handle)) {
+            case LibraryStatus::IO_ERROR:
+                cerr << "Error: Unable to open file for writing." << endl;
+                [[fallthrough]];
+            case LibraryStatus::OK:
+                cout << "Book borrowed successfully. Loan handle: " << handle.toString();
+                return;
+            case LibraryStatus::UNAVAILABLE:
+                offerHold(isbn, borrower);
+                return;
+            default:
+                cout << "Something went wrong. Please try again.";
+        }
+    }
+
+    // Return a book, finding the loan by borrower details. When patrons are waiting, the copy is
+    // lent to the next one in the same step and their loan handle is stored in `handed_off`.
+    LibraryStatus returnBook(const string &isbn, const Borrower &borrower, optional<LoanHandle> *handed_off = nullptr) {
+        LatencyTimer timer(LatencyMetric::RETURN);
+        CatalogGuard guard(*this);
+        Book *book = findBook(isbn);
+        if (!book) { return LibraryStatus::NOT_FOUND; }
+        optional<size_t> loan = book->findLoan(borrower);
+        if (!loan) { return LibraryStatus::NOT_BORROWED; }
+
+        // Publish the loan as it was recorded, with its dates and copy
+        string payload = book->getBorrowers()[*loan].toString();
+        removeLoan(book - books.data(), *loan);
+        return commitReturn(book, payload, handed_off);
+    }
+
+    // Return the loan identified by a handle without searching the borrowers
+    LibraryStatus returnBook(LoanHandle handle, optional<LoanHandle> *handed_off = nullptr) {
+        LatencyTimer timer(LatencyMetric::RETURN);
+        CatalogGuard guard(*this);
+        if (!isLive(handle)) { return LibraryStatus::STALE_HANDLE; }
+
+        LoanSlot slot = loan_slots[handle.index];
+        Book *book = &books[slot.book];
+        string payload = book->getBorrowers()[slot.loan].toString();
+        removeLoan(slot.book, slot.loan);
+
+        return commitReturn(book, payload, handed_off);
+    }
+
+    // The book and borrower of an outstanding loan, or nullptr for a stale handle
+    pair<const Book *, const Borrower *> findLoan(LoanHandle handle) const {
+        if (!isLive(handle)) { return {nullptr, nullptr}; }
+
+        const LoanSlot &slot = loan_slots[handle.index];
+        return {&books[slot.book], &books[slot.book].getBorrowers()[slot.loan]};
+    }
+
+    // Return a book (interactive)
+    void returnBook() {
+        optional<LoanHandle> handed_off;
+        LibraryStatus status;
+        string handle_text = inputISBN("Enter Loan Handle (leave empty to enter ISBN and borrower details):");
+        if (!handle_text.empty()) {
+            optional<LoanHandle> handle = LoanHandle::fromString(handle_text);
+            status = handle ? returnBook(*handle, &handed_off) : LibraryStatus::STALE_HANDLE;
+            if (status == LibraryStatus::STALE_HANDLE) {
+                cout << "Loan handle " << handle_text << " does not match an outstanding loan.";
+                return;
+            }
+        } else {
+            string isbn = inputISBN("Enter ISBN of the book to return:");
+            status = getBook(isbn) ? returnBook(isbn, inputBorrower("Enter Returner Details:"), &handed_off)
+                                   : LibraryStatus::NOT_FOUND;
+        }
+
+        // IO_ERROR: the return and any hand-off were applied, only the catalog file was not written
+        switch (status) {
+            case LibraryStatus::IO_ERROR:
+                cerr << "Error: Unable to open file for writing." << endl;
+                [[fallthrough]];
+            case LibraryStatus::OK:
+                cout << "Book returned successfully.";
+                displayHandOff(handed_off);
+                return;
+            default:
+                cout << "Something went wrong. Please try again.";
+        }
+    }
+
+    // Report a copy lent to the next patron in the hold queue
+    void displayHandOff(const optional<LoanHandle> &handed_off) const {
+        if (!handed_off) { return; }
+
+        auto [book, borrower] = findLoan(*handed_off);
+        cout << endl << "The copy was lent to " << borrower->getName() << ", next in the hold queue for ISBN "
+                << book->getISBN() << ". Loan handle: " << handed_off->toString();
+    }
+
+    static constexpr time_t HOLD_DAYS = 14; // hold expiry offered at the console
+
+    // Queue a patron for a title whose copies are all on loan; holds are not persisted
+    LibraryStatus placeHold(const string &isbn, const Borrower &patron, time_t expires, HoldHandle *handle = nullptr) {
+        if (!holds_enabled) { return LibraryStatus::HOLDS_DISABLED; }
+        CatalogGuard guard(*this);
+        const Book *book = findBook(isbn);
+        if (!book) { return LibraryStatus::NOT_FOUND; }
+        if (book->getAvailableCount() > 0) { return LibraryStatus::AVAILABLE; }
+
+        HoldHandle placed = holds.place(isbn, patron, expires);
+        if (handle) { *handle = placed; }
+        return LibraryStatus::OK;
+    }
+
+    // Refuse new holds from now on, for a catalog whose returns may happen in another process
+    void disableHolds() { holds_enabled = false; }
+
+    LibraryStatus cancelHold(HoldHandle handle) {
+        return holds.cancel(handle) ? LibraryStatus::OK : LibraryStatus::STALE_HANDLE;
+    }
+
+    // Holds waiting for a title
+    size_t getHoldQueueLength(const string &isbn) const { return holds.queueLength(isbn); }
+
+    // Offer a hold to a patron who could not borrow a title (interactive)
+    void offerHold(const string &isbn, const Borrower &patron) {
+        if (!holds_enabled) {
+            cout << "All copies are on loan. Holds are not available while the catalog is shared.";
+            return;
+        }
+
+        string answer;
+        cout << "All copies are on loan (" << getHoldQueueLength(isbn) << " waiting). Place a hold for "
+                << HOLD_DAYS << " days? (y/n):";
+        getline(cin, answer);
+        if (answer != "y" && answer != "Y") { return; }
+
+        HoldHandle handle;
+        if (placeHold(isbn, patron, time(nullptr) + HOLD_DAYS * 24 * 60 * 60, &handle) != LibraryStatus::OK) {
+            cout << "Something went wrong. Please try again.";
+            return;
+        }
+        cout << "Hold placed, position " << getHoldQueueLength(isbn) << " in the queue. Hold handle: " << handle.toString();
+    }
+
+    // Mark a copy lost or damaged, or put it back on the shelf; copies on loan must be returned first.
+    // A copy back on the shelf is lent to the next patron waiting for the title, as on a return,
+    // and their loan handle is stored in `handed_off`.
+    LibraryStatus setCopyState(const string &barcode, CopyState state, optional<LoanHandle> *handed_off = nullptr) {
+        CatalogGuard guard(*this);
+        optional<pair<string, uint32_t>> parsed = Book::parseBarcode(barcode);
+        Book *book = parsed ? findBook(parsed->first) : nullptr;
+        if (!book || !book->getCopyState(parsed->second)) { return LibraryStatus::NOT_FOUND; }
+        if (!book->setCopyState(parsed->second, state)) { return LibraryStatus::UNAVAILABLE; }
+        optional<LoanHandle> handle = state == CopyState::AVAILABLE ? handOff(book) : nullopt;
+
+        bool saved = saveBooksToFile();
+        publishMutation(Mutation::COPY_STATE, book->getISBN(), to_string(parsed->second) + "|" + to_string(int(state)));
+        if (handle) { publishMutation(Mutation::BORROW, book->getISBN(), book->getBorrowers().back().toString()); }
+        if (handed_off) { *handed_off = handle; }
+        return saved ? LibraryStatus::OK : LibraryStatus::IO_ERROR;
+    }
+
+    // State of the copy with the given barcode
+    optional<CopyState> getCopyState(const string &barcode) const {
+        CatalogGuard guard(*this);
+        optional<pair<string, uint32_t>> parsed = Book::parseBarcode(barcode);
+        const Book *book = parsed ? findBook(string_view(parsed->first)) : nullptr;
+        if (!book) { return nullopt; }
+        return book->getCopyState(parsed->second);
+    }
+
+    // Mark a copy lost, damaged or back on the shelf (interactive)
+    void updateCopyState() {
+        string barcode = inputISBN("Enter Copy Barcode:");
+        int choice;
+        cout << "Enter new state (1. Available, 2. Lost, 3. Damaged):";
+        cin >> choice;
+        cin.ignore();
+        if (choice < 1 || choice > 3) {
+            cout << "Invalid choice.";
+            return;
+        }
+
+        CopyState state = choice == 1 ? CopyState::AVAILABLE : choice == 2 ? CopyState::LOST : CopyState::DAMAGED;
+        optional<LoanHandle> handed_off;
+        switch (setCopyState(barcode, state, &handed_off)) {
+            case LibraryStatus::OK:
+                cout << "Copy " << barcode << " updated.";
+                displayHandOff(handed_off);
+                break;
+            case LibraryStatus::UNAVAILABLE:
+                cout << "Copy " << barcode << " is on loan; return it first.";
+                break;
+            case LibraryStatus::IO_ERROR:
+                cerr << "Error: Unable to open file for writing." << endl;
+                displayHandOff(handed_off);
+                break;
+            default:
+                cout << "Copy " << barcode << " not found in the library.";
+        }
+    }
+
+    // Cancel a hold (interactive)
+    void cancelHold() {
+        string handle_text = inputISBN("Enter Hold Handle:");
+
+        optional<HoldHandle> handle = HoldHandle::fromString(handle_text);
+        if (handle && cancelHold(*handle) == LibraryStatus::OK) {
+            cout << "Hold cancelled.";
+            return;
+        }
+
+        cout << "Hold handle " << handle_text << " does not match a waiting hold.";
+    }
+
+    // Display borrowers of a book
+    void displayBookBorrowers() {
+        displayBookBorrowers(inputISBN("Enter ISBN of the book to display borrowers:"));
+    }
+
+    // Display borrowers of the book with the given ISBN
+    void displayBookBorrowers(const string &isbn) {
+        CatalogGuard guard(*this);
+        Book *book = findBook(isbn);
+        if (!book) {
+            cout << "Book with ISBN " << isbn << " not found in the library." << endl;
+            return;
+        }
+
+        displayBorrowers(*book);
+    }
+
+    // Display the borrowers table of a book
+    static void displayBorrowers(const Book &book) {
+        if (book.getBorrowers().size() == 0) {
+            cout << "No borrowers found for the book with ISBN " << book.getISBN() << "." << endl;
+            return;
+        }
+
+        cout << endl << "Borrowers of the book with ISBN " << book.getISBN() << ":" << endl << endl;
+        cout << left
+                << setw(15) << "Name"
+                << setw(15) << "Mobile"
+                << setw(35) << "Email"
+                << setw(15) << "Status"
+                << setw(15) << "Borrow Date"
+                << setw(15) << "Return Date"
+                << "Copy"
+                << endl;
+        cout << string(130, '-') << endl;
+        book.displayBorrowersDetails();
+    }
+};
+
+#endif //LMS_LIBRARY_H
@@ -0,0 +1,212 @@
+#include "lms.h"
+#include "library.h"
+
+// ==================== C Interface ====================>
+
+struct lms_library {
+    Library library;
+
+    explicit lms_library(const char *filename) : library(filename ? filename : "") {}
+};
+
+namespace {
+
+lms_status toStatus(LibraryStatus status) {
+    switch (status) {
+        case LibraryStatus::OK: return LMS_OK;
+        case LibraryStatus::NOT_FOUND: return LMS_NOT_FOUND;
+        case LibraryStatus::ALREADY_EXISTS: return LMS_ALREADY_EXISTS;
+        case LibraryStatus::HAS_BORROWERS: return LMS_HAS_BORROWERS;
+        case LibraryStatus::UNAVAILABLE: return LMS_UNAVAILABLE;
+        case LibraryStatus::NOT_BORROWED: return LMS_NOT_BORROWED;
+        case LibraryStatus::IO_ERROR: return LMS_IO_ERROR;
+        case LibraryStatus::STALE_HANDLE: return LMS_STALE_HANDLE;
+        case LibraryStatus::AVAILABLE: return LMS_AVAILABLE;
+        case LibraryStatus::INVALID_REQUEST:
+        case LibraryStatus::UNREACHABLE:
+        case LibraryStatus::HOLDS_DISABLED: break;
+    }
+    return LMS_INTERNAL_ERROR;
+}
+
+void toBook(const Book &book, lms_book &out) {
+    out.title = book.getTitle().c_str();
+    out.author = book.getAuthor().c_str();
+    out.isbn = book.getISBN().c_str();
+    out.inventory_count = book.getInventoryCount();
+    out.borrowed_count = int32_t(book.getBorrowers().size());
+    out.available_count = book.getAvailableCount();
+}
+
+// Whether a field can be stored: the catalog file and the mutation stream do not escape their
+// separators, so a field must not contain them
+bool isStorable(const char *field) {
+    return field && !strpbrk(field, ",|;\t\r\n");
+}
+
+bool isStorable(const char *name, const char *mobile, const char *email) {
+    return isStorable(name) && isStorable(mobile) && isStorable(email);
+}
+
+// Run a call, keeping C++ exceptions from crossing the C boundary
+template<typename Callable>
+lms_status guarded(Callable &&callable) {
+    try {
+        return callable();
+    } catch (const bad_alloc &) {
+        return LMS_INTERNAL_ERROR;
+    } catch (const exception &) {
+        return LMS_INVALID_ARGUMENT;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+lms_status lms_open(const char *filename, lms_library **library) {
+    if (!library) { return LMS_INVALID_ARGUMENT; }
+    *library = nullptr;
+    try {
+        *library = new lms_library(filename);
+        return LMS_OK;
+    } catch (const bad_alloc &) {
+        return LMS_INTERNAL_ERROR;
+    } catch (const exception &) {
+        return LMS_IO_ERROR; // unreadable or corrupt catalog file
+    }
+}
+
+void lms_close(lms_library *library) {
+    delete library;
+}
+
+lms_status lms_add_book(lms_library *library, const char *title, const char *author, const char *isbn,
+                        int32_t inventory_count) {
+    if (!library || !isStorable(title) || !isStorable(author) || !isStorable(isbn) || !*isbn || inventory_count < 0) {
+        return LMS_INVALID_ARGUMENT;
+    }
+    return guarded([&] { return toStatus(library->library.addBook(Book(title, author, isbn, inventory_count))); });
+}
+
+lms_status lms_delete_book(lms_library *library, const char *isbn) {
+    if (!library || !isbn) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] { return toStatus(library->library.deleteBook(isbn)); });
+}
+
+lms_status lms_borrow_book(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                           const char *email) {
+    if (!library || !isbn || !isStorable(name, mobile, email)) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] { return toStatus(library->library.borrowBook(isbn, Borrower(name, mobile, email))); });
+}
+
+lms_status lms_return_book(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                           const char *email) {
+    if (!library || !isbn || !isStorable(name, mobile, email)) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] { return toStatus(library->library.returnBook(isbn, Borrower(name, mobile, email))); });
+}
+
+lms_status lms_borrow_book_handle(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                                  const char *email, uint64_t *loan) {
+    if (!library || !isbn || !isStorable(name, mobile, email) || !loan) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] {
+        LoanHandle handle;
+        lms_status status = toStatus(library->library.borrowBook(isbn, Borrower(name, mobile, email), &handle));
+        if (status == LMS_OK || status == LMS_IO_ERROR) { *loan = handle.pack(); }
+        return status;
+    });
+}
+
+lms_status lms_return_loan(lms_library *library, uint64_t loan) {
+    if (!library) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] { return toStatus(library->library.returnBook(LoanHandle::unpack(loan))); });
+}
+
+lms_status lms_place_hold(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                          const char *email, int64_t expires, uint64_t *hold) {
+    if (!library || !isbn || !isStorable(name, mobile, email) || !hold) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] {
+        HoldHandle handle;
+        lms_status status = toStatus(library->library.placeHold(isbn, Borrower(name, mobile, email), expires, &handle));
+        if (status == LMS_OK) { *hold = handle.pack(); }
+        return status;
+    });
+}
+
+lms_status lms_cancel_hold(lms_library *library, uint64_t hold) {
+    if (!library) { return LMS_INVALID_ARGUMENT; }
+    return toStatus(library->library.cancelHold(HoldHandle::unpack(hold)));
+}
+
+size_t lms_hold_queue_length(const lms_library *library, const char *isbn) {
+    return library && isbn ? library->library.getHoldQueueLength(isbn) : 0;
+}
+
+lms_status lms_set_copy_state(lms_library *library, const char *barcode, lms_copy_state state) {
+    if (!library || !barcode || state < LMS_COPY_AVAILABLE || state > LMS_COPY_DAMAGED || state == LMS_COPY_ON_LOAN) {
+        return LMS_INVALID_ARGUMENT;
+    }
+    return guarded([&] { return toStatus(library->library.setCopyState(barcode, CopyState(state))); });
+}
+
+lms_status lms_get_copy_state(const lms_library *library, const char *barcode, lms_copy_state *state) {
+    if (!library || !barcode || !state) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] {
+        optional<CopyState> found = library->library.getCopyState(barcode);
+        if (!found) { return LMS_NOT_FOUND; }
+        *state = lms_copy_state(*found);
+        return LMS_OK;
+    });
+}
+
+lms_status lms_get_book(const lms_library *library, const char *isbn, lms_book *book) {
+    if (!library || !isbn || !book) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] {
+        const Book *found = library->library.findBook(string_view(isbn));
+        if (!found) { return LMS_NOT_FOUND; }
+        toBook(*found, *book);
+        return LMS_OK;
+    });
+}
+
+size_t lms_book_count(const lms_library *library) {
+    return library ? library->library.getBooksCount() : 0;
+}
+
+lms_status lms_list_books(const lms_library *library, const char *cursor, size_t page_size, lms_book_visitor visit,
+                          void *context, char *next_cursor, size_t next_cursor_size) {
+    if (!library || !visit || !next_cursor || (cursor && !isValidCursor(cursor))) { return LMS_INVALID_ARGUMENT; }
+    return guarded([&] {
+        string next;
+        vector<const Book *> page = library->library.getBooksPage(cursor ? cursor : "", page_size, next);
+        if (next.size() >= next_cursor_size) { return LMS_BUFFER_TOO_SMALL; }
+
+        memcpy(next_cursor, next.c_str(), next.size() + 1);
+        lms_book book;
+        for (const auto *entry: page) {
+            toBook(*entry, book);
+            visit(&book, context);
+        }
+        return LMS_OK;
+    });
+}
+
+const char *lms_status_string(lms_status status) {
+    switch (status) {
+        case LMS_OK: return "ok";
+        case LMS_NOT_FOUND: return "not found";
+        case LMS_ALREADY_EXISTS: return "already exists";
+        case LMS_HAS_BORROWERS: return "has borrowers";
+        case LMS_UNAVAILABLE: return "unavailable";
+        case LMS_NOT_BORROWED: return "not borrowed";
+        case LMS_IO_ERROR: return "i/o error";
+        case LMS_INVALID_ARGUMENT: return "invalid argument";
+        case LMS_BUFFER_TOO_SMALL: return "buffer too small";
+        case LMS_INTERNAL_ERROR: return "internal error";
+        case LMS_STALE_HANDLE: return "stale handle";
+        case LMS_AVAILABLE: return "copy available";
+    }
+    return "unknown status";
+}
+
+} // extern "C"
@@ -0,0 +1,119 @@
+#ifndef LMS_H
+#define LMS_H
+
+/*
+ * C interface to the library catalog (liblms).
+ *
+ * Every call takes its input as parameters and reports through its return value; nothing reads
+ * stdin or writes to the terminal. A handle is not thread-safe: serialize calls on the same handle.
+ * Status values and struct layouts are part of the ABI; new values and functions are only appended.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum lms_status {
+    LMS_OK = 0,
+    LMS_NOT_FOUND = 1,
+    LMS_ALREADY_EXISTS = 2,
+    LMS_HAS_BORROWERS = 3,
+    LMS_UNAVAILABLE = 4,
+    LMS_NOT_BORROWED = 5,
+    LMS_IO_ERROR = 6,          /* applied in memory, but the catalog file could not be written */
+    LMS_INVALID_ARGUMENT = 7,
+    LMS_BUFFER_TOO_SMALL = 8,
+    LMS_INTERNAL_ERROR = 9,
+    LMS_STALE_HANDLE = 10,     /* the loan or hold handle was already used or never issued */
+    LMS_AVAILABLE = 11         /* a copy is free, so a hold is not needed */
+} lms_status;
+
+typedef struct lms_library lms_library;
+
+/* A book; the strings stay valid until the next call that modifies the library */
+typedef struct lms_book {
+    const char *title;
+    const char *author;
+    const char *isbn;
+    int32_t inventory_count;
+    int32_t borrowed_count;
+    int32_t available_count; /* copies on the shelf: lost and damaged copies are neither borrowed nor available */
+} lms_book;
+
+typedef void (*lms_book_visitor)(const lms_book *book, void *context);
+
+/* Open the catalog saved in filename, or an in-memory catalog when filename is NULL or "" */
+lms_status lms_open(const char *filename, lms_library **library);
+void lms_close(lms_library *library);
+
+/*
+ * Titles, authors, ISBNs and borrower details are stored unescaped, so they cannot contain ',', '|',
+ * ';', a tab or a line break; such input is rejected with LMS_INVALID_ARGUMENT.
+ */
+lms_status lms_add_book(lms_library *library, const char *title, const char *author, const char *isbn,
+                        int32_t inventory_count);
+lms_status lms_delete_book(lms_library *library, const char *isbn);
+
+/* Borrowers are identified by name, mobile and email; a loan runs for 15 days */
+lms_status lms_borrow_book(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                           const char *email);
+lms_status lms_return_book(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                           const char *email);
+
+/*
+ * Borrow and store the loan's handle in *loan; returning by handle skips the search over the
+ * title's borrowers. A handle is valid until its loan is returned or the library is closed; after
+ * that it is reported as LMS_STALE_HANDLE. Each open numbers handles from a random starting point,
+ * so a handle from an earlier session or another process is reported the same way.
+ */
+lms_status lms_borrow_book_handle(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                                  const char *email, uint64_t *loan);
+lms_status lms_return_loan(lms_library *library, uint64_t loan);
+
+/*
+ * Queue a patron for a title whose copies are all on loan, until the expires time (seconds since
+ * the epoch). A return lends the copy to the first unexpired hold in the same call. Holds are kept
+ * in memory only.
+ */
+lms_status lms_place_hold(lms_library *library, const char *isbn, const char *name, const char *mobile,
+                          const char *email, int64_t expires, uint64_t *hold);
+lms_status lms_cancel_hold(lms_library *library, uint64_t hold);
+size_t lms_hold_queue_length(const lms_library *library, const char *isbn);
+
+/*
+ * Copies of a title are numbered from 1; a copy's barcode is "<isbn>-<number>" with the number
+ * padded to three digits. Only copies on the shelf, lost or damaged can change state;
+ * LMS_UNAVAILABLE is returned for a copy on loan.
+ */
+typedef enum lms_copy_state {
+    LMS_COPY_AVAILABLE = 0,
+    LMS_COPY_ON_LOAN = 1,
+    LMS_COPY_LOST = 2,
+    LMS_COPY_DAMAGED = 3
+} lms_copy_state;
+
+lms_status lms_set_copy_state(lms_library *library, const char *barcode, lms_copy_state state);
+lms_status lms_get_copy_state(const lms_library *library, const char *barcode, lms_copy_state *state);
+
+lms_status lms_get_book(const lms_library *library, const char *isbn, lms_book *book);
+size_t lms_book_count(const lms_library *library);
+
+/*
+ * Visit up to page_size books after cursor (NULL or "" for the first page) in ISBN order, and write
+ * the cursor of the next page to next_cursor, "" after the last page. LMS_BUFFER_TOO_SMALL is
+ * returned before visiting anything when next_cursor_size cannot hold the cursor, and
+ * LMS_INVALID_ARGUMENT when cursor was not written by an earlier call.
+ */
+lms_status lms_list_books(const lms_library *library, const char *cursor, size_t page_size, lms_book_visitor visit,
+                          void *context, char *next_cursor, size_t next_cursor_size);
+
+const char *lms_status_string(lms_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LMS_H */
@@ -0,0 +1,464 @@
+#include <utility>
+
+#include "lms.h"
+#include "library.h"
+#include "ledger.h"
+#include "analytics.h"
+#include "reminders.h"
+#include "fines.h"
+#include "branches.h"
+#include "synthetic_data.h"
+
+// ==================== Benchmark Report ====================>
+
+// Writes one JSON object per measurement
+class BenchReport {
+    ostream &out;
+
+public:
+    explicit BenchReport(ostream &out) : out(out) {}
+
+    void record(const string &benchmark, size_t scale, size_t ops, double seconds, size_t bytes = 0) {
+        out << fixed << setprecision(6)
+                << "{\"benchmark\":\"" << benchmark << "\",\"scale\":" << scale << ",\"ops\":" << ops
+                << ",\"seconds\":" << seconds << ",\"ops_per_second\":" << (seconds > 0 ? ops / seconds : 0);
+        if (bytes > 0) {
+            out << ",\"bytes\":" << bytes << ",\"mb_per_second\":" << (seconds > 0 ? bytes / 1e6 / seconds : 0);
+        }
+        out << "}" << endl;
+    }
+
+    // Live and peak bytes per subsystem at this point of the run
+    void recordMemory(size_t scale) {
+        out << "{\"benchmark\":\"memory\",\"scale\":" << scale << ",\"memory\":" << MemoryAccounting::instance().toJson()
+                << "}" << endl;
+    }
+};
+
+// Seconds taken by a callable
+template<typename Callable>
+double timeIt(Callable &&callable) {
+    auto start = chrono::steady_clock::now();
+    callable();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// ==================== Benchmarks ====================>
+
+// Measure load, save, lookup, borrow, return and listing on a synthetic catalog of `scale` titles
+void benchmarkCatalog(BenchReport &report, SyntheticConfig config, size_t scale, size_t ops, const string &dir) {
+    config.titles = scale;
+    string path = dir + "/lms_bench_catalog.csv";
+    SyntheticLibrary generator(config);
+
+    vector<Book> books;
+    report.record("generate", scale, scale, timeIt([&] { books = generator.generateCatalog(); }));
+
+    Library library("");
+    report.record("insert", scale, scale, timeIt([&] {
+        for (auto &book: books) {
+            library.addBook(book);
+        }
+    }));
+    books = vector<Book>();
+    report.recordMemory(scale);
+
+    bool saved = false;
+    double save_seconds = timeIt([&] { saved = library.saveBooksToFile(path); });
+    if (!saved) {
+        cerr << "Error: Unable to write " << path << "." << endl;
+        return;
+    }
+    size_t file_bytes = size_t(ifstream(path, ios::binary | ios::ate).tellg());
+    report.record("save", scale, scale, save_seconds, file_bytes);
+
+    optional<Library> loaded;
+    report.record("load", scale, scale, timeIt([&] { loaded.emplace(path); }), file_bytes);
+    loaded.reset();
+
+    mt19937_64 rng(config.seed);
+    vector<string> keys(ops);
+    for (auto &key: keys) {
+        key = SyntheticLibrary::isbnOf(rng() % scale);
+    }
+
+    size_t found = 0;
+    report.record("lookup", scale, ops, timeIt([&] {
+        for (const auto &key: keys) {
+            found += as_const(library).findBook(key) != nullptr;
+        }
+    }));
+
+    // Borrow then return one copy per operation; titles without a free copy are simply skipped
+    vector<Borrower> patrons;
+    patrons.reserve(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        patrons.push_back(SyntheticLibrary::patronOf(config.borrowers + i, config.now, config.now + 15 * 24 * 60 * 60));
+    }
+    vector<char> borrowed(ops);
+    report.record("borrow", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            borrowed[i] = library.borrowBook(keys[i], patrons[i]) == LibraryStatus::OK;
+        }
+    }));
+    report.record("return", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (borrowed[i]) { library.returnBook(keys[i], patrons[i]); }
+        }
+    }));
+
+    // The same loans returned through their handles instead of a search over the borrowers
+    vector<LoanHandle> handles(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        borrowed[i] = library.borrowBook(keys[i], patrons[i], &handles[i]) == LibraryStatus::OK;
+    }
+    report.record("return_handle", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (borrowed[i]) { library.returnBook(handles[i]); }
+        }
+    }));
+
+    // Listing through the paged API, discarding the formatted pages
+    size_t listed_bytes = 0;
+    double list_seconds = timeIt([&] {
+        string cursor, out;
+        do {
+            out.clear();
+            cursor = library.appendBooksPage(cursor, 1000, out);
+            listed_bytes += out.size();
+        } while (!cursor.empty());
+    });
+    report.record("list", scale, scale, list_seconds, listed_bytes);
+
+    // Every mutation currently rewrites the catalog file; measure a few persisted borrows
+    Library persisted(path);
+    size_t persisted_ops = min<size_t>(ops, 10);
+    report.record("borrow_persisted", scale, persisted_ops, timeIt([&] {
+        for (size_t i = 0; i < persisted_ops; ++i) {
+            persisted.borrowBook(keys[i], patrons[i]);
+        }
+    }));
+
+    remove(path.c_str());
+}
+
+// Measure incremental updates, the parallel rebuild and top-k queries of the recommendation engine
+void benchmarkRecommendations(BenchReport &report, SyntheticConfig config, size_t scale, size_t events) {
+    config.titles = scale;
+    SyntheticLibrary generator(config);
+    vector<pair<string, string>> borrows = generator.generateLoanHistory(events);
+
+    RecommendationEngine incremental;
+    report.record("recommend_incremental", scale, events, timeIt([&] {
+        for (const auto &[patron, isbn]: borrows) {
+            incremental.recordBorrow(patron, isbn);
+        }
+    }));
+
+    RecommendationEngine rebuilt;
+    report.record("recommend_rebuild", scale, events, timeIt([&] {
+        rebuilt.rebuild(borrows, max(1u, thread::hardware_concurrency()));
+    }));
+
+    size_t queries = min<size_t>(scale, 100000), results = 0;
+    vector<string> keys;
+    for (size_t i = 0; i < queries; ++i) {
+        keys.push_back(SyntheticLibrary::isbnOf(i));
+    }
+    report.record("recommend_query", scale, queries, timeIt([&] {
+        for (const auto &key: keys) {
+            results += rebuilt.recommend(key).size();
+        }
+    }));
+}
+
+// Hold placement on one hot title, checkout next to its queue, and returns that hand each copy on
+void benchmarkHolds(BenchReport &report, SyntheticConfig config, size_t scale, size_t ops) {
+    config.titles = scale;
+    Library library("");
+    for (const auto &book: SyntheticLibrary(config).generateCatalog()) {
+        library.addBook(book);
+    }
+
+    vector<Borrower> patrons;
+    for (size_t i = 0; i < ops; ++i) {
+        patrons.push_back(SyntheticLibrary::patronOf(config.borrowers + i, config.now, config.now + 15 * 24 * 60 * 60));
+    }
+
+    // Lend out every copy of the hot title
+    string hot = SyntheticLibrary::isbnOf(0);
+    vector<LoanHandle> loans;
+    LoanHandle loan;
+    while (library.borrowBook(hot, patrons[loans.size() % ops], &loan) == LibraryStatus::OK) {
+        loans.push_back(loan);
+    }
+
+    time_t expires = time(nullptr) + Library::HOLD_DAYS * 24 * 60 * 60;
+    report.record("hold_place", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            library.placeHold(hot, patrons[i], expires);
+        }
+    }));
+
+    mt19937_64 rng(config.seed);
+    vector<string> keys(ops);
+    for (auto &key: keys) {
+        key = SyntheticLibrary::isbnOf(1 + rng() % (scale - 1));
+    }
+    report.record("borrow_with_holds", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (library.borrowBook(keys[i], patrons[i], &loan) == LibraryStatus::OK) { library.returnBook(loan); }
+        }
+    }));
+
+    size_t hand_offs = 0;
+    report.record("hold_handoff", scale, ops, timeIt([&] {
+        for (size_t i = 0; hand_offs < ops && !loans.empty(); i = (i + 1) % loans.size()) {
+            optional<LoanHandle> handed_off;
+            library.returnBook(loans[i], &handed_off);
+            if (!handed_off) { break; }
+            loans[i] = *handed_off;
+            ++hand_offs;
+        }
+    }));
+}
+
+// Keep a value alive so the optimizer cannot drop the call that produced it
+template<typename T>
+void keepValue(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// A catalog dealt across in-memory branches: borrow and return on one branch through its lock, against
+// the same cycle on a standalone Library, and cross-branch availability lookups by ISBN and by text
+void benchmarkBranches(BenchReport &report, SyntheticConfig config, size_t scale, size_t ops) {
+    constexpr size_t BRANCHES = 8;
+    config.titles = scale;
+    vector<string> names;
+    for (size_t b = 0; b < BRANCHES; ++b) {
+        names.push_back("branch" + to_string(b));
+    }
+    BranchNetwork network(names, false);
+    Library standalone("");
+    vector<Book> books = SyntheticLibrary(config).generateCatalog();
+    for (size_t i = 0; i < books.size(); ++i) {
+        network.withBranch(i % BRANCHES, [&](Library &library) { library.addBook(books[i]); });
+        if (i % BRANCHES == 0) { standalone.addBook(books[i]); }
+    }
+
+    mt19937_64 rng(config.seed);
+    vector<string> keys(ops);
+    for (auto &key: keys) {
+        key = SyntheticLibrary::isbnOf(rng() % ((scale + BRANCHES - 1) / BRANCHES) * BRANCHES);
+    }
+    Borrower patron = SyntheticLibrary::patronOf(config.borrowers, config.now, config.now + 15 * 24 * 60 * 60);
+
+    report.record("borrow_return_single", scale, ops, timeIt([&] {
+        for (const auto &key: keys) {
+            if (standalone.borrowBook(key, patron) == LibraryStatus::OK) { standalone.returnBook(key, patron); }
+        }
+    }));
+    report.record("borrow_return_branch", scale, ops, timeIt([&] {
+        for (const auto &key: keys) {
+            network.withBranch(0, [&](Library &library) {
+                if (library.borrowBook(key, patron) == LibraryStatus::OK) { library.returnBook(key, patron); }
+            });
+        }
+    }));
+
+    size_t lookups = min<size_t>(ops, 1000), found = 0;
+    report.record("where_available", scale, lookups, timeIt([&] {
+        for (size_t i = 0; i < lookups; ++i) {
+            found += network.whereAvailable(SyntheticLibrary::isbnOf(rng() % scale)).size();
+        }
+    }));
+    keepValue(found);
+
+    report.record("where_available_text", scale, 10, timeIt([&] {
+        for (size_t i = 0; i < 10; ++i) {
+            found += network.whereAvailable("Title " + to_string(rng() % scale)).size();
+        }
+    }));
+    keepValue(found);
+}
+
+// Due-date timers for `scale` loans spread over a loan period: schedule two per loan, cancel the
+// returned half, then fire the rest by stepping the wheel through every one-minute tick
+void benchmarkReminders(BenchReport &report, const SyntheticConfig &config, size_t scale) {
+    constexpr uint64_t PERIOD_TICKS = 15 * 24 * 60;
+    size_t timers = 2 * scale;
+    mt19937_64 rng(config.seed);
+    vector<uint64_t> ticks(timers);
+    for (auto &tick: ticks) {
+        tick = 1 + rng() % PERIOD_TICKS;
+    }
+
+    TimerWheel wheel;
+    vector<TimerWheel::Handle> handles(timers);
+    report.record("timer_schedule", scale, timers, timeIt([&] {
+        for (size_t i = 0; i < timers; ++i) {
+            handles[i] = wheel.schedule(ticks[i], uint32_t(i));
+        }
+    }));
+
+    report.record("timer_cancel", scale, timers / 2, timeIt([&] {
+        for (size_t i = 0; i < timers; i += 2) {
+            wheel.cancel(handles[i]);
+        }
+    }));
+
+    size_t fired = 0, pending = wheel.size();
+    report.record("timer_fire", scale, pending, timeIt([&] {
+        wheel.advance(PERIOD_TICKS, [&](uint64_t, uint32_t) { ++fired; });
+    }));
+    keepValue(fired);
+}
+
+// Nightly fine run over `loans` return dates: one Borrower at a time with a clock read per loan, as
+// the display path did, against the batch kernel
+void benchmarkFines(BenchReport &report, const SyntheticConfig &config, size_t scale, size_t loans) {
+    mt19937_64 rng(config.seed);
+    vector<Borrower> borrowers;
+    vector<time_t> return_dates(loans);
+    for (size_t i = 0; i < loans; ++i) {
+        return_dates[i] = config.now - 30 * 24 * 60 * 60 + time_t(rng() % (45 * 24 * 60 * 60));
+        if (i < min<size_t>(loans, 1 << 20)) { borrowers.emplace_back("", "", "", config.now, return_dates[i]); }
+    }
+    FeeSchedule schedule;
+    vector<int32_t> days(loans), fines(loans);
+
+    int64_t total = 0;
+    report.record("fines_scalar", scale, loans, timeIt([&] {
+        for (size_t i = 0; i < loans; ++i) {
+            const Borrower &borrower = borrowers[i % borrowers.size()];
+            if (borrower.isBookOverdue()) {
+                total += schedule.fineFor(int32_t((time(nullptr) - borrower.getReturnDate() + 24 * 60 * 60 - 1) / (24 * 60 * 60)));
+            }
+        }
+    }));
+    keepValue(total);
+
+    report.record("fines_kernel", scale, loans, timeIt([&] {
+        total = OverdueKernel::run(return_dates, time(nullptr), schedule, days, fines).total_cents;
+    }));
+    keepValue(total);
+}
+
+// Per-call overhead of the C interface against the same calls on Library
+void benchmarkCallOverhead(BenchReport &report, SyntheticConfig config, size_t scale, size_t ops) {
+    config.titles = scale;
+    Library library("");
+    lms_library *handle;
+    if (lms_open(nullptr, &handle) != LMS_OK) { return; }
+    for (const auto &book: SyntheticLibrary(config).generateCatalog()) {
+        library.addBook(book);
+        lms_add_book(handle, book.getTitle().c_str(), book.getAuthor().c_str(), book.getISBN().c_str(),
+                     book.getInventoryCount());
+    }
+
+    mt19937_64 rng(config.seed);
+    vector<string> keys(ops);
+    for (auto &key: keys) {
+        key = SyntheticLibrary::isbnOf(rng() % scale);
+    }
+
+    report.record("cpp_book_count", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keepValue(library.getBooksCount());
+        }
+    }));
+    report.record("capi_book_count", scale, ops, timeIt([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keepValue(lms_book_count(handle));
+        }
+    }));
+    report.record("cpp_get_book", scale, ops, timeIt([&] {
+        for (const auto &key: keys) {
+            keepValue(as_const(library).findBook(key));
+        }
+    }));
+    report.record("capi_get_book", scale, ops, timeIt([&] {
+        lms_book book;
+        for (const auto &key: keys) {
+            keepValue(lms_get_book(handle, key.c_str(), &book));
+        }
+    }));
+
+    lms_close(handle);
+}
+
+// ==================== Main Function ====================>
+
+// Usage:
+//   lms_bench [--scales 1000,10000,...] [--ops <n>] [--loan-events <n>] [--seed <n>] [--copies <n>]
+//             [--borrowers <n>] [--loan-ratio <r>] [--overdue-ratio <r>] [--dir <path>] [--output <file>]
+//   lms_bench --generate <file> [--titles <n>] [generator options]   write a synthetic catalog and exit
+int main(int argc, char *argv[]) {
+    SyntheticConfig config;
+    vector<size_t> scales = {1000, 10000, 100000, 1000000};
+    size_t ops = 100000, loan_events = 0;
+    string dir = ".", output, generate_path;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--scales") {
+            scales.clear();
+            istringstream ss(value);
+            string scale;
+            while (getline(ss, scale, ',')) {
+                scales.push_back(stoull(scale));
+            }
+        } else if (option == "--ops") {
+            ops = stoull(value);
+        } else if (option == "--loan-events") {
+            loan_events = stoull(value);
+        } else if (option == "--seed") {
+            config.seed = stoull(value);
+        } else if (option == "--titles") {
+            config.titles = stoull(value);
+        } else if (option == "--copies") {
+            config.max_copies = stoi(value);
+        } else if (option == "--borrowers") {
+            config.borrowers = stoull(value);
+        } else if (option == "--loan-ratio") {
+            config.loan_ratio = stod(value);
+        } else if (option == "--overdue-ratio") {
+            config.overdue_ratio = stod(value);
+        } else if (option == "--now") {
+            config.now = stoll(value);
+        } else if (option == "--dir") {
+            dir = value;
+        } else if (option == "--output") {
+            output = value;
+        } else if (option == "--generate") {
+            generate_path = value;
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+
+    if (!generate_path.empty()) {
+        if (!SyntheticLibrary(config).writeCatalog(generate_path)) {
+            cerr << "Error: Unable to write " << generate_path << "." << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    ofstream outFile;
+    if (!output.empty()) { outFile.open(output); }
+    BenchReport report(output.empty() ? cout : outFile);
+
+    for (size_t scale: scales) {
+        benchmarkCatalog(report, config, scale, min(ops, scale), dir);
+        benchmarkRecommendations(report, config, scale, loan_events > 0 ? loan_events : scale);
+        benchmarkHolds(report, config, scale, min(ops, scale));
+        benchmarkBranches(report, config, scale, min(ops, scale));
+        benchmarkReminders(report, config, scale);
+        benchmarkFines(report, config, scale, 4 * scale);
+        benchmarkCallOverhead(report, config, scale, ops);
+    }
+
+    return 0;
+}
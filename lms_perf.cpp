@@ -0,0 +1,225 @@
+#include <map>
+
+#include "library.h"
+#include "synthetic_data.h"
+
+// ==================== Workloads ====================>
+
+// Throughput of one workload run
+struct PerfResult {
+    size_t ops = 0;
+    double seconds = 0;
+
+    double opsPerSecond() const { return seconds > 0 ? ops / seconds : 0; }
+};
+
+// Seconds taken by a callable
+template<typename Callable>
+double timeIt(Callable &&callable) {
+    auto start = chrono::steady_clock::now();
+    callable();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Fixed-seed workloads over a synthetic catalog written to `dir`
+class PerfSuite {
+    SyntheticConfig config;
+    size_t cycles;
+    string path;
+
+public:
+    PerfSuite(SyntheticConfig config, size_t cycles, const string &dir, const string &workload)
+        : config(config), cycles(cycles), path(dir + "/lms_perf_" + workload + ".csv") {}
+
+    // Write the catalog file the load and listing workloads read
+    bool prepare(const string &workload) const {
+        return workload == "borrow_return" || SyntheticLibrary(config).writeCatalog(path);
+    }
+
+    // Parse and index the whole catalog file
+    PerfResult load() const {
+        optional<Library> library;
+        PerfResult result{config.titles};
+        result.seconds = timeIt([&] { library.emplace(path); });
+        return result;
+    }
+
+    // Borrow one copy of a random title and return it again; titles without a free copy are skipped
+    PerfResult borrowReturn() const {
+        mt19937_64 rng(config.seed);
+        vector<string> keys(cycles);
+        for (auto &key: keys) {
+            key = SyntheticLibrary::isbnOf(rng() % config.titles);
+        }
+        vector<Borrower> patrons;
+        for (size_t i = 0; i < min<size_t>(cycles, 4096); ++i) {
+            patrons.push_back(SyntheticLibrary::patronOf(config.borrowers + i, config.now, config.now + 15 * 24 * 60 * 60));
+        }
+
+        // Persisting every mutation would measure the disk; cycle on an in-memory catalog
+        Library memory("");
+        for (auto &book: SyntheticLibrary(config).generateCatalog()) {
+            memory.addBook(book);
+        }
+
+        PerfResult result{cycles};
+        result.seconds = timeIt([&] {
+            for (size_t i = 0; i < cycles; ++i) {
+                const Borrower &patron = patrons[i % patrons.size()];
+                if (memory.borrowBook(keys[i], patron) == LibraryStatus::OK) { memory.returnBook(keys[i], patron); }
+            }
+        });
+        return result;
+    }
+
+    // Format every page of the catalog listing and write it to /dev/null
+    PerfResult listing() const {
+        Library library(path);
+        ofstream devNull("/dev/null", ios::binary);
+        PerfResult result{library.getBooksCount()};
+        result.seconds = timeIt([&] {
+            string cursor, out;
+            do {
+                out.clear();
+                cursor = library.appendBooksPage(cursor, 1000, out);
+                devNull.write(out.data(), streamsize(out.size()));
+            } while (!cursor.empty());
+            devNull.flush();
+        });
+        return result;
+    }
+
+    bool run(const string &workload, PerfResult &result) const {
+        if (workload == "load") {
+            result = load();
+        } else if (workload == "borrow_return") {
+            result = borrowReturn();
+        } else if (workload == "list") {
+            result = listing();
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// ==================== Baseline ====================>
+
+// Baseline file: one "<workload> <ops per second>" line per workload, '#' starts a comment
+map<string, double> readBaseline(const string &path) {
+    map<string, double> baseline;
+    ifstream inFile(path);
+    string line;
+    while (getline(inFile, line)) {
+        if (line.empty() || line[0] == '#') { continue; }
+        istringstream ss(line);
+        string workload;
+        double ops_per_second;
+        if (ss >> workload >> ops_per_second) { baseline[workload] = ops_per_second; }
+    }
+    return baseline;
+}
+
+// Replace the baseline entries, keeping the leading comment block
+bool writeBaseline(const string &path, const map<string, double> &baseline) {
+    string header;
+    ifstream inFile(path);
+    string line;
+    while (getline(inFile, line) && (line.empty() || line[0] == '#')) {
+        header += line + '\n';
+    }
+    inFile.close();
+
+    ofstream outFile(path);
+    outFile << header << fixed << setprecision(0);
+    for (const auto &[workload, ops_per_second]: baseline) {
+        outFile << workload << ' ' << ops_per_second << '\n';
+    }
+    return bool(outFile);
+}
+
+// ==================== Main Function ====================>
+
+// Usage:
+//   lms_perf --workload <load|borrow_return|list> --baseline <file> [--tolerance <r>] [--books <n>]
+//            [--cycles <n>] [--seed <n>] [--dir <path>] [--update-baseline 1]
+//
+// Fails when throughput falls more than `tolerance` (a fraction, default 0.3) below the baseline.
+// With --update-baseline 1 the measured throughput is written to the baseline file instead.
+int main(int argc, char *argv[]) {
+    SyntheticConfig config;
+    config.titles = 1000000;
+    size_t cycles = 1000000;
+    double tolerance = 0.3;
+    bool update = false;
+    string workload, baseline_path, dir = ".";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--workload") {
+            workload = value;
+        } else if (option == "--baseline") {
+            baseline_path = value;
+        } else if (option == "--tolerance") {
+            tolerance = stod(value);
+        } else if (option == "--books") {
+            config.titles = stoull(value);
+        } else if (option == "--cycles") {
+            cycles = stoull(value);
+        } else if (option == "--seed") {
+            config.seed = stoull(value);
+        } else if (option == "--dir") {
+            dir = value;
+        } else if (option == "--update-baseline") {
+            update = value == "1";
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 2;
+        }
+    }
+    if (workload.empty() || baseline_path.empty()) {
+        cerr << "Error: --workload and --baseline are required." << endl;
+        return 2;
+    }
+
+    PerfSuite suite(config, cycles, dir, workload);
+    if (!suite.prepare(workload)) {
+        cerr << "Error: Unable to write the synthetic catalog to " << dir << "." << endl;
+        return 2;
+    }
+
+    PerfResult result;
+    if (!suite.run(workload, result)) {
+        cerr << "Error: Unknown workload " << workload << "." << endl;
+        return 2;
+    }
+
+    map<string, double> baseline = readBaseline(baseline_path);
+    cout << fixed << setprecision(0) << workload << ": " << result.ops << " ops in " << setprecision(3)
+            << result.seconds << " s, " << setprecision(0) << result.opsPerSecond() << " ops/s" << endl;
+
+    if (update) {
+        baseline[workload] = result.opsPerSecond();
+        if (!writeBaseline(baseline_path, baseline)) {
+            cerr << "Error: Unable to write " << baseline_path << "." << endl;
+            return 2;
+        }
+        cout << "Baseline updated." << endl;
+        return 0;
+    }
+
+    auto it = baseline.find(workload);
+    if (it == baseline.end()) {
+        cerr << "Error: No baseline for " << workload << " in " << baseline_path << "." << endl;
+        return 2;
+    }
+
+    double minimum = it->second * (1 - tolerance);
+    cout << "baseline " << it->second << " ops/s, minimum " << minimum << " ops/s" << endl;
+    if (result.opsPerSecond() < minimum) {
+        cerr << fixed << setprecision(1) << "FAIL: " << workload << " throughput regressed by "
+                << (1 - result.opsPerSecond() / it->second) * 100 << "%." << endl;
+        return 1;
+    }
+    return 0;
+}
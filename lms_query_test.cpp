@@ -0,0 +1,54 @@
+#include "library.h"
+
+// ==================== Query Range Test ====================>
+
+// Usage:
+//   lms_query_test
+//
+// Queries bounding the ISBN are read from the index; each must match exactly the books a full scan
+// with the same predicate matches, including queries whose bounds contradict each other.
+int main() {
+    Library library("");
+    for (char digit = '1'; digit <= '9'; ++digit) {
+        library.addBook(Book("Title " + string(1, digit), "Author", string(1, digit), 1));
+    }
+
+    const vector<pair<string, size_t>> cases = {
+            {"isbn > \"5\" and isbn < \"3\"", 0},
+            {"isbn = \"2\" and isbn = \"7\"", 0},
+            {"isbn > \"5\" and isbn < \"5\"", 0},
+            {"isbn >= \"5\" and isbn < \"5\"", 0},
+            {"isbn > \"5\" and isbn <= \"5\"", 0},
+            {"isbn >= \"5\" and isbn > \"5\" and isbn <= \"6\"", 1},
+            {"isbn >= \"5\" and isbn <= \"5\"", 1},
+            {"isbn > \"3\" and isbn < \"7\"", 3},
+            {"isbn >= \"3\" and isbn <= \"7\"", 5},
+            {"isbn > \"9\"", 0},
+            {"isbn < \"1\"", 0},
+    };
+
+    int failures = 0;
+    for (const auto &[text, expected]: cases) {
+        string error;
+        optional<CompiledQuery> query = QueryEngine::compile(text, error);
+        if (!query) {
+            cerr << "FAIL: " << text << ": " << error << endl;
+            ++failures;
+            continue;
+        }
+
+        size_t scanned = 0;
+        for (const auto &book: library.getBooks()) {
+            if (query->predicate(book)) { ++scanned; }
+        }
+        size_t matched = library.queryBooks(*query, 1).size();
+        if (matched != expected || scanned != expected) {
+            cerr << "FAIL: " << text << ": index matched " << matched << ", scan " << scanned << ", expected "
+                    << expected << endl;
+            ++failures;
+        }
+    }
+
+    cout << "query_ranges: " << cases.size() - failures << " of " << cases.size() << " queries passed" << endl;
+    return failures == 0 ? 0 : 1;
+}
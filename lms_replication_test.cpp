@@ -0,0 +1,118 @@
+#include <sys/wait.h>
+
+#include "replication.h"
+
+// ==================== Replication Test ====================>
+
+static const string ISBN = "978-0-00-000001-1";
+
+static Borrower patron(size_t number) { return Borrower("Patron " + to_string(number), to_string(number), "p@example.com"); }
+
+// Connect a replica once the primary reports its head sequence on `from`, wait until it has applied
+// that sequence, and send its catalog back on `to`
+static int runReplica(const string &socket_path, int from, int to) {
+    uint64_t head;
+    if (read(from, &head, sizeof(head)) != ssize_t(sizeof(head))) { return 1; }
+
+    ReplicaNode replica(socket_path, INT64_MAX);
+    for (int waited_ms = 0; replica.appliedSeq() < head; waited_ms += 10) {
+        if (waited_ms > 10000) { return 1; }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    string out;
+    replica.query([&](Library &library) {
+        for (const auto &line: library.snapshot()) {
+            out += line + "\n";
+        }
+    });
+    return sendAll(to, out) ? 0 : 1;
+}
+
+// Usage:
+//   lms_replication_test [--dir <path>] [--cycles <n>]
+//
+// A primary lends one copy around a hold queue, so every return hands the copy to the next patron,
+// compacting its replication log between operations as the lms menu does. A replica process then
+// joins from the compacted snapshot and must end with the primary's catalog.
+int main(int argc, char *argv[]) {
+    string dir = ".";
+    size_t cycles = 200;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--dir") {
+            dir = value;
+        } else if (option == "--cycles") {
+            cycles = stoull(value);
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 2;
+        }
+    }
+    string socket_path = dir + "/lms_replication_test.sock";
+
+    // The replica is forked before the primary starts its threads
+    int to_replica[2], from_replica[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, to_replica) != 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, from_replica) != 0) {
+        return 2;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(to_replica[1]);
+        close(from_replica[0]);
+        _exit(runReplica(socket_path, to_replica[0], from_replica[1]));
+    }
+    close(to_replica[0]);
+    close(from_replica[1]);
+
+    Library library("");
+    ReplicationPrimary primary(socket_path, library.snapshot(), library.getLastSeq(), 16);
+    library.addMutationListener([&](const Mutation &mutation) { primary.append(mutation); });
+    auto compact = [&] {
+        if (primary.needsCompaction()) { primary.compact(library.snapshot(), library.getLastSeq()); }
+    };
+
+    bool ok = library.addBook(Book("Title", "Author", ISBN, 1)) == LibraryStatus::OK &&
+              library.borrowBook(ISBN, patron(0)) == LibraryStatus::OK;
+    compact();
+    for (size_t i = 1; ok && i <= cycles; ++i) {
+        optional<LoanHandle> handed_off;
+        ok = library.placeHold(ISBN, patron(i), time(nullptr) + 3600) == LibraryStatus::OK;
+        compact();
+        ok = ok && library.returnBook(ISBN, patron(i - 1), &handed_off) == LibraryStatus::OK && handed_off;
+        compact();
+    }
+    if (!ok) {
+        cerr << "FAIL: the primary could not hand the copy around the hold queue." << endl;
+        return 1;
+    }
+
+    string expected;
+    for (const auto &line: library.snapshot()) {
+        expected += line + "\n";
+    }
+    uint64_t head = library.getLastSeq();
+    [[maybe_unused]] ssize_t written = write(to_replica[1], &head, sizeof(head));
+    close(to_replica[1]);
+
+    string replicated;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(from_replica[0], buffer, sizeof(buffer))) > 0) {
+        replicated.append(buffer, length);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    cout << "replication: " << head << " mutations replicated" << endl;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << "FAIL: the replica did not catch up with the primary." << endl;
+        return 1;
+    }
+    if (replicated != expected) {
+        cerr << "FAIL: the replica's catalog differs from the primary's." << endl << "primary:" << endl << expected
+                << "replica:" << endl << replicated;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <map>
+#include <sys/wait.h>
+
+#include "ledger.h"
+#include "shared_catalog.h"
+
+// ==================== Shared Ledger Test ====================>
+
+static const vector<string> ISBNS = {"978-0-00-000001-1", "978-0-00-000002-2", "978-0-00-000003-3"};
+
+static string patronName(int process, size_t loan) { return "p" + to_string(process) + "-" + to_string(loan); }
+
+// Borrow `loans` books in one process sharing the catalog, returning every other one, with the
+// ledger wired to the library as the lms menu wires it
+static bool runProcess(int process, size_t loans, const string &region, const string &catalog, const string &ledger_path) {
+    Library library("");
+    SharedCatalog shared(library, region, catalog);
+    if (!shared.isAttached()) { return false; }
+
+    LoanLedger ledger(ledger_path);
+    library.addMutationListener([&](const Mutation &mutation) {
+        if (shared.isApplyingRemote()) {
+            ledger.refresh();
+        } else {
+            ledger.record(mutation);
+        }
+    });
+
+    for (size_t i = 0; i < loans; ++i) {
+        Borrower borrower(patronName(process, i), "555", "p@example.com");
+        const string &isbn = ISBNS[i % ISBNS.size()];
+        if (library.borrowBook(isbn, borrower) != LibraryStatus::OK) { return false; }
+        if (i % 2 == 0 && library.returnBook(isbn, borrower) != LibraryStatus::OK) { return false; }
+    }
+    return true;
+}
+
+// Usage:
+//   lms_shared_ledger_test [--dir <path>] [--loans <n>]
+//
+// Two processes share one catalog and append their loans to one ledger file at the same time; the
+// file must then replay every loan under the right book and patron.
+int main(int argc, char *argv[]) {
+    string dir = ".";
+    size_t loans = 500;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--dir") {
+            dir = value;
+        } else if (option == "--loans") {
+            loans = stoull(value);
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 2;
+        }
+    }
+
+    string region = dir + "/lms_shared_ledger.shm";
+    string catalog = dir + "/lms_shared_ledger.csv";
+    string ledger_path = dir + "/lms_shared_ledger.ledger";
+    unlink(region.c_str());
+    unlink(ledger_path.c_str());
+    Library seed("");
+    for (const auto &isbn: ISBNS) {
+        seed.addBook(Book("Title " + isbn, "Author", isbn, int(loans * 2)));
+    }
+    if (!seed.saveBooksToFile(catalog)) {
+        cerr << "Error: Unable to write " << catalog << "." << endl;
+        return 2;
+    }
+
+    vector<pid_t> children;
+    for (int process = 0; process < 2; ++process) {
+        pid_t pid = fork();
+        if (pid == 0) { _exit(runProcess(process, loans, region, catalog, ledger_path) ? 0 : 1); }
+        children.push_back(pid);
+    }
+    bool ok = true;
+    for (pid_t child: children) {
+        int status;
+        ok = waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+    }
+    if (!ok) {
+        cerr << "FAIL: a process could not borrow or return." << endl;
+        return 1;
+    }
+
+    // Borrows and returns per book|patron
+    map<string, pair<size_t, size_t>> expected, replayed;
+    for (int process = 0; process < 2; ++process) {
+        for (size_t i = 0; i < loans; ++i) {
+            auto &counts = expected[ISBNS[i % ISBNS.size()] + "|" + patronName(process, i) + "|555|p@example.com"];
+            ++counts.first;
+            if (i % 2 == 0) { ++counts.second; }
+        }
+    }
+    LoanLedger ledger(ledger_path);
+    ledger.scanTimeRange(INT64_MIN, INT64_MAX, [&](const LoanEvent &event) {
+        auto &counts = replayed[ledger.bookKey(event.book_id) + "|" + ledger.patronKey(event.patron_id)];
+        ++(event.type == LoanEvent::BORROW ? counts.first : counts.second);
+    });
+
+    cout << "shared_ledger: " << ledger.eventCount() << " events replayed" << endl;
+    if (replayed != expected) {
+        cerr << "FAIL: the ledger file does not replay the loans both processes made." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,414 +1,509 @@
-#include <iostream>
-#include <string>
-#include <vector>
-#include <fstream>
-#include <iomanip>
-#include <ctime>
+#include <cmath>
+
+#include "library.h"
+#include "ledger.h"
+#include "analytics.h"
+#include "replication.h"
+#include "reminders.h"
+#include "cdc.h"
+#include "catalog_watch.h"
+#include "shared_catalog.h"
+#include "fines.h"
+#include "sharding.h"
+#include "branches.h"
 
-using namespace std;
-
-// ==================== Borrower Class ====================>
-
-class Borrower {
-    string name;
-    string mobile;
-    string email;
-    time_t borrow_date;
-    time_t return_date;
-
-public:
-    Borrower(string name, string mobile, string email, time_t borrow_date = time(nullptr),
-             time_t return_date = time(nullptr) + 15 * 24 * 60 * 60) {
-        this->name = name;
-        this->mobile = mobile;
-        this->email = email;
-        this->borrow_date = borrow_date;
-        this->return_date = return_date;
-    }
+// ==================== Library Management System ====================>
 
-    // Getters
-    string getName() const { return name; }
-    string getMobile() const { return mobile; }
-    string getEmail() const { return email; }
-    bool isBookOverdue() const { return time(nullptr) > return_date; }
+class LibraryManagementSystem {
+    Library library;
+    LoanLedger ledger;
+    BorrowAnalytics analytics;
+    RecommendationEngine recommendations;
+    unique_ptr<ReplicationPrimary> replication;
+    unique_ptr<ReminderScheduler> reminders;
+    unique_ptr<ChangeFeed> change_feed;
+    unique_ptr<SharedCatalog> shared_catalog;
+    mutex library_mutex; // held by menu operations and by edits applied from the catalog watcher
+    unique_ptr<CatalogWatcher> watcher;
 
-    string getBorrowDateStr() const {
-        tm tm_borrow_date = *localtime(&borrow_date);
-        ostringstream oss;
-        oss << put_time(&tm_borrow_date, "%d-%m-%Y");
-        return oss.str();
+    void displayMenu() {
+        cout << endl << "*************** Library Management System ***************" << endl << endl;
+        cout << "1. Add a Book" << endl;
+        cout << "2. Delete a Book" << endl;
+        cout << "3. View All Books" << endl;
+        cout << "4. Total Books Count in Library" << endl;
+        cout << "5. Borrow a Book" << endl;
+        cout << "6. Return a Book" << endl;
+        cout << "7. View Book Borrowers" << endl;
+        cout << "8. Search Books" << endl;
+        cout << "9. Export Catalog" << endl;
+        cout << "10. Bulk Import Books" << endl;
+        cout << "11. Query Books" << endl;
+        cout << "12. Loan History" << endl;
+        cout << "13. Most Borrowed and Trending Books" << endl;
+        cout << "14. Recommendations for a Book" << endl;
+        cout << "15. Performance Statistics" << endl;
+        cout << "16. Cancel a Hold" << endl;
+        cout << "17. Mark a Copy Lost, Damaged or Available" << endl;
+        cout << "0. Exit" << endl << endl;
     }
 
-    string getReturnDateStr() const {
-        tm tm_return_date = *localtime(&return_date);
-        ostringstream oss;
-        oss << put_time(&tm_return_date, "%d-%m-%Y");
-        return oss.str();
-    }
+    // Display latency percentiles and memory usage per subsystem, and save them as JSON
+    void displayStatistics() {
+        cout << endl << LatencyHistograms::instance().summaryTable();
+        cout << endl << MemoryAccounting::instance().summaryTable();
 
-    // Converts borrower data to string format
-    string toString() const {
-        return name + "|" + mobile + "|" + email + "|" + to_string(borrow_date) + "|" + to_string(return_date);
+        ofstream outFile("lms_stats.json");
+        outFile << statisticsJson() << endl;
+        if (outFile) { cout << endl << "Statistics saved to lms_stats.json." << endl; }
     }
 
-    // Creates a Borrower object from string data
-    static Borrower fromString(string str) {
-        string name, contact, email, borrow_date_str, return_date_str;
+    // Display books co-borrowed with a book
+    void displayRecommendations() {
+        string isbn = inputISBN("Enter ISBN of the book to get recommendations for:");
 
-        istringstream ss(str);
-        getline(ss, name, '|');
-        getline(ss, contact, '|');
-        getline(ss, email, '|');
-        getline(ss, borrow_date_str, '|');
-        getline(ss, return_date_str);
-
-        return Borrower(name, contact, email, stol(borrow_date_str), stol(return_date_str));
-    }
+        vector<pair<string, uint32_t>> neighbours = recommendations.recommend(isbn, 5);
+        if (neighbours.empty()) {
+            cout << "No recommendations found for the book with ISBN " << isbn << "." << endl;
+            return;
+        }
 
-    // Compare two borrowers
-    bool compare(const Borrower &borrower) const {
-        return name == borrower.name && mobile == borrower.mobile && email == borrower.email;
+        cout << endl << "Patrons who borrowed ISBN " << isbn << " also borrowed:" << endl << endl;
+        string out;
+        for (const auto &[other, patrons]: neighbours) {
+            optional<Book> book = library.getBook(other);
+            appendPadded(out, book ? book->getTitle() : "(deleted)", 30);
+            appendPadded(out, other, 15);
+            out += to_string(patrons) + (patrons == 1 ? " patron\n" : " patrons\n");
+        }
+        cout << out;
     }
-};
 
-// ==================== Book Class ====================>
-
-class Book {
-    string title;
-    string author;
-    string isbn;
-    int inventory_count;
-    vector<Borrower> borrowers;
-
-public:
-    // Constructor
-    Book(string title, string author, string isbn, int inventory_count, vector<Borrower> borrowers = {}) {
-        this->title = title;
-        this->author = author;
-        this->isbn = isbn;
-        this->inventory_count = inventory_count;
-        this->borrowers = borrowers;
-    }
-
-    // Getters
-    string getTitle() const { return title; }
-    string getAuthor() const { return author; }
-    string getISBN() const { return isbn; }
-    int getInventoryCount() const { return inventory_count; }
-    vector<Borrower> getBorrowers() const { return borrowers; }
-
-    // Converts book data to string format
-    string toString() const {
-        string borrowersStr;
-        for (const auto &borrower: borrowers) {
-            borrowersStr += borrower.toString() + ";";
+    // Display a ranking of ISBNs with their titles
+    void displayRanking(const string &heading, const vector<pair<string, double>> &ranking) {
+        cout << endl << heading << ":" << endl << endl;
+        if (ranking.empty()) {
+            cout << "No borrows recorded yet." << endl;
+            return;
         }
 
-        return title + "," + author + "," + isbn + "," + to_string(inventory_count) + "," + borrowersStr;
+        string out;
+        for (size_t i = 0; i < ranking.size(); ++i) {
+            optional<Book> book = library.getBook(ranking[i].first);
+            appendPadded(out, to_string(i + 1) + ".", 5);
+            appendPadded(out, book ? book->getTitle() : "(deleted)", 30);
+            appendPadded(out, ranking[i].first, 15);
+            out += to_string(llround(ranking[i].second)) + '\n';
+        }
+        cout << out;
     }
 
-    // Creates a Book object from string data
-    static Book fromString(string str) {
-        string title, author, isbn, inventory_count_str, borrowersStr;
-        vector<Borrower> borrowers;
+    // Display borrow and return events of the last days, for one book or all books
+    void displayLoanHistory() {
+        string isbn = inputISBN("Enter ISBN (empty for all books):");
 
-        istringstream ss(str);
-        getline(ss, title, ',');
-        getline(ss, author, ',');
-        getline(ss, isbn, ',');
-        getline(ss, inventory_count_str, ',');
-        getline(ss, borrowersStr);
+        int days;
+        cout << "Enter Number of Days:";
+        cin >> days;
+        cin.ignore(); // Clear the input buffer
 
-        istringstream ssBorrowers(borrowersStr);
-        string borrowerStr;
-        while (getline(ssBorrowers, borrowerStr, ';')) {
-            borrowers.push_back(Borrower::fromString(borrowerStr));
+        time_t to = time(nullptr) + 1;
+        time_t from = to - time_t(days) * 24 * 60 * 60;
+
+        string out;
+        size_t count = 0;
+        auto appendEvent = [&](const LoanEvent &event) {
+            char date[DateFormatter::LENGTH];
+            appendPadded(out, ledger.bookKey(event.book_id), 15);
+            appendPadded(out, event.type == LoanEvent::BORROW ? "Borrow" : "Return", 10);
+            out.append(date, DateFormatter::format(event.time, date));
+            out += "     ";
+            out += ledger.patronKey(event.patron_id);
+            out += '\n';
+            ++count;
+        };
+
+        if (isbn.empty()) {
+            ledger.scanTimeRange(from, to, appendEvent);
+        } else {
+            ledger.scanBook(isbn, from, to, appendEvent);
         }
 
-        return Book(title, author, isbn, stoi(inventory_count_str), borrowers);
-    }
-
-    // Borrow a book
-    bool borrowBook(const Borrower &borrower) {
-        if (inventory_count - borrowers.size() > 0) {
-            borrowers.push_back(borrower);
-            return true;
+        if (count == 0) {
+            cout << endl << "No loan events found." << endl;
+            return;
         }
 
-        return false;
+        cout << endl << left << setw(15) << "ISBN" << setw(10) << "Event" << setw(15) << "Date" << "Borrower" << endl;
+        cout << string(80, '-') << endl;
+        cout << out << count << " events" << endl;
     }
 
-    // Return a book
-    bool returnBook(const Borrower &borrower) {
-        for (auto it = borrowers.begin(); it != borrowers.end(); ++it) {
-            if (it->compare(borrower)) {
-                borrowers.erase(it);
-                return true;
-            }
-        }
-
-        return false;
-    }
-
-    // Display book details
-    void displayBookDetails() const {
-        cout << left
-                << setw(20) << title
-                << setw(20) << author
-                << setw(15) << isbn
-                << setw(15) << inventory_count
-                << setw(15) << inventory_count - borrowers.size()
-                << setw(15) << (inventory_count - borrowers.size() > 0 ? "Available" : "Not Available")
-                << endl;
-    }
-
-    // Display borrowers details
-    void displayBorrowersDetails() const {
-        for (const auto &borrower: borrowers) {
-            cout << left
-                    << setw(15) << borrower.getName()
-                    << setw(15) << borrower.getMobile()
-                    << setw(35) << borrower.getEmail()
-                    << setw(15) << (borrower.isBookOverdue() ? "Overdue" : "Not Overdue")
-                    << setw(15) << borrower.getBorrowDateStr()
-                    << setw(15) << borrower.getReturnDateStr()
-                    << endl;
+public:
+    // The catalog is read from library_books.csv, or shared with other processes through the region
+    // file when one is given
+    explicit LibraryManagementSystem(const string &shared_region = "")
+        : library(shared_region.empty() ? "library_books.csv" : "") {
+        if (!shared_region.empty()) { shared_catalog = make_unique<SharedCatalog>(library, shared_region); }
+
+        // Warm the analytics window from the loan history
+        {
+            TraceSpan span("analytics.warm");
+            time_t now = time(nullptr);
+            ledger.scanTimeRange(now - BorrowAnalytics::WINDOW_DAYS * 24 * 60 * 60, now + 1, [this](const LoanEvent &event) {
+                if (event.type == LoanEvent::BORROW) { analytics.recordBorrow(ledger.bookKey(event.book_id), event.time); }
+            });
         }
-    }
-};
-
-// ==================== Library Class ====================>
 
-class Library {
-    vector<Book> books;
-    string filename = "library_books.csv";
+        recommendations.rebuild(ledger, max(1u, thread::hardware_concurrency()));
 
-    // Save books to file
-    void saveBooksToFile() const {
-        ofstream outFile(filename);
-        if (!outFile) {
-            cerr << "Error: Unable to open file for writing." << endl;
-            return;
-        }
+        library.addMutationListener([this](const Mutation &mutation) {
+            // Each process appends its own loans to the ledger file and reads back the others'
+            if (shared_catalog && shared_catalog->isApplyingRemote()) {
+                ledger.refresh();
+            } else {
+                ledger.record(mutation);
+            }
+            analytics.recordBorrow(mutation);
+            recommendations.recordBorrow(mutation);
+        });
+    }
 
-        for (const auto &book: books) {
-            outFile << book.toString() << endl;
-        }
+    // Whether the catalog is shared, if it was meant to be
+    bool isCatalogReady() const { return !shared_catalog || shared_catalog->isAttached(); }
 
-        outFile.close();
+    // Ship every committed mutation to replicas connecting on the given socket
+    void startReplication(const string &socket_path) {
+        replication = make_unique<ReplicationPrimary>(socket_path, library.snapshot(), library.getLastSeq());
+        library.addMutationListener([this](const Mutation &mutation) { replication->append(mutation); });
     }
 
-    // Load books from file
-    void loadBooksFromFile() {
-        ifstream inFile(filename);
-        if (!inFile) { return; }
-
-        books.clear();
-        string line;
-        while (getline(inFile, line)) {
-            books.push_back(Book::fromString(line));
+    // Fold a long replication log into a snapshot; between operations, so the catalog matches the
+    // last published mutation
+    void compactReplicationLog() {
+        if (replication && replication->needsCompaction()) {
+            replication->compact(library.snapshot(), library.getLastSeq());
         }
-
-        inFile.close();
     }
 
-    // Input book ISBN
-    string inputISBN(string message) {
-        string isbn;
-        cout << endl << message;
-        getline(cin, isbn);
-        return isbn;
+    // Publish every committed mutation to change feed subscribers on the given socket
+    void startChangeFeed(const string &socket_path) {
+        change_feed = make_unique<ChangeFeed>(socket_path);
+        library.addMutationListener([this](const Mutation &mutation) { change_feed->publish(mutation); });
     }
 
-public:
-    // Constructor
-    Library() {
-        // Load saved books from file
-        loadBooksFromFile();
+    // Send due-soon and overdue reminders for active loans to a file or a "unix:<path>" socket
+    void startReminders(const string &sink_spec) {
+        reminders = make_unique<ReminderScheduler>(parseReminderSink(sink_spec));
+        reminders->populate(library);
+        library.addMutationListener([this](const Mutation &mutation) { reminders->onMutation(mutation); });
+        reminders->start();
     }
 
-    // Add a book to library
-    void addBook() {
-        string title, author, isbn;
-        int inventory_count;
-
-        cout << endl << "Enter Book Title:";
-        getline(cin, title);
-
-        cout << "Enter Author Name:";
-        getline(cin, author);
+    // Apply edits other programs save to the catalog file once it has been quiet for settle_ms
+    void startWatching(int settle_ms) {
+        watcher = make_unique<CatalogWatcher>(library.getFilename(), [this] {
+            lock_guard<mutex> lock(library_mutex);
+            ReloadReport report = library.reloadChangedRecords();
+            if (!report.changed) { return; }
+            cout << endl << "Catalog file changed. " << report.toString() << endl;
+            Library::displayRejects(report.rejects);
+            compactReplicationLog();
+        }, settle_ms);
+    }
 
-        cout << "Enter ISBN:";
-        getline(cin, isbn);
+    void run() {
+        while (true) {
+            // Display menu
+            displayMenu();
 
-        cout << "Enter Inventory Count:";
-        cin >> inventory_count;
-        cin.ignore(); // Clear the input buffer
+            int choice;
+            cout << "Enter your choice: ";
+            cin >> choice;
+            cin.ignore(); // Clear the input buffer
 
-        // Check if book with same ISBN already exists
-        for (const auto &book: books) {
-            if (book.getISBN() == isbn) {
-                cout << "Book with ISBN " << isbn << " already exists in the library." << endl;
-                return;
+            lock_guard<mutex> lock(library_mutex);
+            switch (choice) {
+                case 1:
+                    library.addBook();
+                    break;
+                case 2:
+                    library.deleteBook();
+                    break;
+                case 3:
+                    library.displayBooks();
+                    break;
+                case 4:
+                    library.displayTotalBooksCount();
+                    break;
+                case 5:
+                    library.borrowBook();
+                    break;
+                case 6:
+                    library.returnBook();
+                    break;
+                case 7:
+                    library.displayBookBorrowers();
+                    break;
+                case 8:
+                    library.searchBooks();
+                    break;
+                case 9:
+                    library.exportBooks();
+                    break;
+                case 10:
+                    library.importBooks();
+                    break;
+                case 11:
+                    library.queryBooks();
+                    break;
+                case 12:
+                    displayLoanHistory();
+                    break;
+                case 13:
+                    displayRanking("Most Borrowed This Month", analytics.topBorrowed(10));
+                    displayRanking("Trending This Week", analytics.topTrending(10));
+                    break;
+                case 14:
+                    displayRecommendations();
+                    break;
+                case 15:
+                    displayStatistics();
+                    break;
+                case 16:
+                    library.cancelHold();
+                    break;
+                case 17:
+                    library.updateCopyState();
+                    break;
+                case 0:
+                    cout << endl << "Exiting the Library Management System. Goodbye!" << endl;
+                    return;
+                default:
+                    cout << "Invalid choice. Please try again." << endl;
             }
+            compactReplicationLog();
         }
+    }
+};
+
+// ==================== Replica Management System ====================>
 
-        books.push_back(Book(title, author, isbn, inventory_count));
-        saveBooksToFile();
+class ReplicaManagementSystem {
+    ReplicaNode replica;
 
-        cout << endl << "Book '" << title << "' added successfully!" << endl;
+    void displayMenu() {
+        cout << endl << "*************** Library Management System (Read-Only Replica) ***************" << endl << endl;
+        cout << "1. View All Books" << endl;
+        cout << "2. Total Books Count in Library" << endl;
+        cout << "3. View Book Borrowers" << endl;
+        cout << "4. Replication Status" << endl;
+        cout << "0. Exit" << endl << endl;
     }
 
-    // Delete a book from library
-    void deleteBook() {
-        string isbn = inputISBN("Enter ISBN of the book to delete:");
+public:
+    ReplicaManagementSystem(const string &socket_path, int64_t max_lag_ms) : replica(socket_path, max_lag_ms) {}
 
-        for (auto book = books.begin(); book != books.end(); ++book) {
-            if (book->getISBN() == isbn) {
-                if (book->getBorrowers().size() > 0) {
-                    cout << "Book with ISBN " << isbn << " has been borrowed and cannot be deleted." << endl;
-                    return;
+    void run() {
+        while (true) {
+            // Display menu
+            displayMenu();
+
+            int choice;
+            cout << "Enter your choice: ";
+            if (!(cin >> choice)) { return; }
+            cin.ignore(); // Clear the input buffer
+
+            switch (choice) {
+                case 1:
+                    displayPaged([&](const string &cursor, string &out) {
+                        string next_cursor;
+                        replica.query([&](Library &library) {
+                            next_cursor = library.appendBooksPage(cursor, 20, out);
+                        });
+                        return next_cursor;
+                    });
+                    break;
+                case 2:
+                    replica.query([](Library &library) { library.displayTotalBooksCount(); });
+                    break;
+                case 3: {
+                    string isbn;
+                    cout << endl << "Enter ISBN of the book to display borrowers:";
+                    getline(cin, isbn);
+                    replica.query([&isbn](Library &library) { library.displayBookBorrowers(isbn); });
+                    break;
                 }
-                books.erase(book);
-                saveBooksToFile();
-                cout << "Book with ISBN " << isbn << " deleted successfully." << endl;
-                return;
+                case 4:
+                    cout << endl << replica.metrics();
+                    break;
+                case 0:
+                    cout << endl << "Exiting the Library Management System. Goodbye!" << endl;
+                    return;
+                default:
+                    cout << "Invalid choice. Please try again." << endl;
             }
         }
+    }
+};
+
+// ==================== Sharded Management System ====================>
+
+class ShardedManagementSystem {
+    ShardRouter router;
 
-        cout << "Book with ISBN " << isbn << " not found in the library." << endl;
+    void displayMenu() {
+        cout << endl << "*************** Library Management System (" << router.shardCount()
+                << " Shards) ***************" << endl << endl;
+        cout << "1. Add a Book" << endl;
+        cout << "2. Delete a Book" << endl;
+        cout << "3. View All Books" << endl;
+        cout << "4. Total Books Count in Library" << endl;
+        cout << "5. Borrow a Book" << endl;
+        cout << "6. Return a Book" << endl;
+        cout << "7. View Book Borrowers" << endl;
+        cout << "8. Search Books" << endl;
+        cout << "0. Exit" << endl << endl;
     }
 
-    // Display all books in library
-    void displayBooks() {
+    static void displayBooks(const vector<Book> &books, const string &empty_message) {
         if (books.empty()) {
-            cout << endl << "No books in the library." << endl;
+            cout << endl << empty_message << endl;
             return;
         }
 
-        cout << endl << "Library Book Catalog:" << endl << endl;
-        cout << left
-                << setw(20) << "Title"
-                << setw(20) << "Author"
-                << setw(15) << "ISBN"
-                << setw(15) << "Inventory"
-                << setw(15) << "Available"
-                << setw(15) << "Status"
-                << endl;
-        cout << string(100, '-') << endl;
-
+        Library::displayBookHeader();
         for (const auto &book: books) {
             book.displayBookDetails();
         }
     }
 
-    // Display total books in library
-    void displayTotalBooksCount() {
-        cout << endl << "Total books in library: " << books.size() << endl;
+    // Whether a shard applied the change; IO_ERROR means it did but could not save its file, as for
+    // an unsharded library
+    static bool applied(LibraryStatus status) {
+        if (status == LibraryStatus::IO_ERROR) { cerr << "Error: Unable to open file for writing." << endl; }
+        return status == LibraryStatus::OK || status == LibraryStatus::IO_ERROR;
     }
 
-    // Borrow a book
-    void borrowBook() {
-        string isbn = inputISBN("Enter ISBN of the book to borrow:");
-
-        for (auto &book: books) {
-            if (book.getISBN() == isbn) {
-                string name, mobile, email;
-
-                cout << endl << "Enter Borrower Details:" << endl;
-
-                cout << "Enter Name:";
-                getline(cin, name);
-
-                cout << "Enter Mobile:";
-                getline(cin, mobile);
+public:
+    explicit ShardedManagementSystem(size_t shard_count) : router(shard_count) {}
 
-                cout << "Enter Email:";
-                getline(cin, email);
+    void run() {
+        while (true) {
+            // Display menu
+            displayMenu();
 
-                Borrower borrower(name, mobile, email);
+            int choice;
+            cout << "Enter your choice: ";
+            if (!(cin >> choice)) { return; }
+            cin.ignore(); // Clear the input buffer
 
-                if (book.borrowBook(borrower)) {
-                    saveBooksToFile();
-                    cout << "Book borrowed successfully.";
-                    return;
+            switch (choice) {
+                case 1: {
+                    Book book = inputBook();
+                    LibraryStatus status = router.addBook(book);
+                    if (status == LibraryStatus::ALREADY_EXISTS) {
+                        cout << "Book with ISBN " << book.getISBN() << " already exists in the library." << endl;
+                    } else if (applied(status)) {
+                        cout << endl << "Book '" << book.getTitle() << "' added successfully!" << endl;
+                    } else {
+                        cout << "Something went wrong. Please try again." << endl;
+                    }
+                    break;
                 }
-            }
-        }
-
-        cout << "Something went wrong. Please try again.";
-    }
-
-    // Return a book
-    void returnBook() {
-        string isbn = inputISBN("Enter ISBN of the book to return:");
-
-        for (auto &book: books) {
-            if (book.getISBN() == isbn) {
-                string name, mobile, email;
-
-                cout << endl << "Enter Returner Details:" << endl;
-
-                cout << "Enter Name:";
-                getline(cin, name);
-
-                cout << "Enter Mobile:";
-                getline(cin, mobile);
-
-                cout << "Enter Email:";
-                getline(cin, email);
-
-                Borrower borrower(name, mobile, email);
-
-                if (book.returnBook(borrower)) {
-                    saveBooksToFile();
-                    cout << "Book returned successfully.";
-                    return;
+                case 2: {
+                    string isbn = inputISBN("Enter ISBN of the book to delete:");
+                    switch (LibraryStatus status = router.deleteBook(isbn)) {
+                        case LibraryStatus::IO_ERROR:
+                        case LibraryStatus::OK:
+                            applied(status);
+                            cout << "Book with ISBN " << isbn << " deleted successfully." << endl;
+                            break;
+                        case LibraryStatus::HAS_BORROWERS:
+                            cout << "Book with ISBN " << isbn << " has been borrowed and cannot be deleted." << endl;
+                            break;
+                        case LibraryStatus::INVALID_REQUEST:
+                        case LibraryStatus::UNREACHABLE:
+                            cout << "Something went wrong. Please try again." << endl;
+                            break;
+                        default:
+                            cout << "Book with ISBN " << isbn << " not found in the library." << endl;
+                    }
+                    break;
                 }
-            }
-        }
-
-        cout << "Something went wrong. Please try again.";
-    }
-
-    // Display borrowers of a book
-    void displayBookBorrowers() {
-        string isbn = inputISBN("Enter ISBN of the book to display borrowers:");
-
-        for (const auto &book: books) {
-            if (book.getISBN() == isbn) {
-                if (book.getBorrowers().size() == 0) {
-                    cout << "No borrowers found for the book with ISBN " << isbn << "." << endl;
-                    return;
+                case 3:
+                    displayPaged([&](const string &cursor, string &out) {
+                        string next_cursor;
+                        vector<Book> page = router.listBooksPage(cursor, 20, next_cursor);
+                        if (page.empty()) {
+                            out += "\nNo books in the library.\n";
+                            return next_cursor;
+                        }
+
+                        Library::appendBookHeader(out);
+                        for (const auto &book: page) {
+                            book.appendBookDetails(out);
+                        }
+                        return next_cursor;
+                    });
+                    break;
+                case 4:
+                    cout << endl << "Total books in library: " << router.countBooks() << endl;
+                    break;
+                case 5: {
+                    string isbn = inputISBN("Enter ISBN of the book to borrow:");
+                    if (router.getBook(isbn) && applied(router.borrowBook(isbn, inputBorrower("Enter Borrower Details:")))) {
+                        cout << "Book borrowed successfully.";
+                    } else {
+                        cout << "Something went wrong. Please try again.";
+                    }
+                    break;
                 }
-
-                cout << endl << "Borrowers of the book with ISBN " << isbn << ":" << endl << endl;
-                cout << left
-                        << setw(15) << "Name"
-                        << setw(15) << "Mobile"
-                        << setw(35) << "Email"
-                        << setw(15) << "Status"
-                        << setw(15) << "Borrow Date"
-                        << setw(15) << "Return Date"
-                        << endl;
-                cout << string(110, '-') << endl;
-                book.displayBorrowersDetails();
-
-                return;
+                case 6: {
+                    string isbn = inputISBN("Enter ISBN of the book to return:");
+                    if (router.getBook(isbn) && applied(router.returnBook(isbn, inputBorrower("Enter Returner Details:")))) {
+                        cout << "Book returned successfully.";
+                    } else {
+                        cout << "Something went wrong. Please try again.";
+                    }
+                    break;
+                }
+                case 7: {
+                    string isbn = inputISBN("Enter ISBN of the book to display borrowers:");
+                    optional<Book> book = router.getBook(isbn);
+                    if (book) {
+                        Library::displayBorrowers(*book);
+                    } else {
+                        cout << "Book with ISBN " << isbn << " not found in the library." << endl;
+                    }
+                    break;
+                }
+                case 8: {
+                    string text;
+                    cout << endl << "Enter text to search in titles and authors:";
+                    getline(cin, text);
+                    displayBooks(router.searchBooks(text), "No books match '" + text + "'.");
+                    break;
+                }
+                case 0:
+                    cout << endl << "Exiting the Library Management System. Goodbye!" << endl;
+                    return;
+                default:
+                    cout << "Invalid choice. Please try again." << endl;
             }
         }
-
-        cout << "Book with ISBN " << isbn << " not found in the library." << endl;
     }
 };
 
-// ==================== Library Management System ====================>
+// ==================== Branch Management System ====================>
 
-class LibraryManagementSystem {
-    Library library;
+class BranchManagementSystem {
+    BranchNetwork network;
+    size_t current = 0;
 
     void displayMenu() {
-        cout << endl << "*************** Library Management System ***************" << endl << endl;
+        cout << endl << "*************** Library Management System (Branch " << network.branchName(current)
+                << ") ***************" << endl << endl;
         cout << "1. Add a Book" << endl;
         cout << "2. Delete a Book" << endl;
         cout << "3. View All Books" << endl;
@@ -416,10 +511,64 @@ class LibraryManagementSystem {
         cout << "5. Borrow a Book" << endl;
         cout << "6. Return a Book" << endl;
         cout << "7. View Book Borrowers" << endl;
+        cout << "8. Search Books" << endl;
+        cout << "9. Find an Available Copy in Any Branch" << endl;
+        cout << "10. Switch Branch" << endl;
         cout << "0. Exit" << endl << endl;
     }
 
+    void findAvailableCopy() {
+        string query;
+        cout << endl << "Enter ISBN, or text to search in titles and authors:";
+        getline(cin, query);
+
+        vector<BranchCopy> copies = network.whereAvailable(query);
+        if (copies.empty()) {
+            cout << endl << "No branch has a free copy matching '" << query << "'." << endl;
+            return;
+        }
+
+        string out;
+        out += '\n';
+        appendPadded(out, "Branch", 15);
+        appendPadded(out, "Title", 20);
+        appendPadded(out, "Author", 20);
+        appendPadded(out, "ISBN", 15);
+        out += "Available\n";
+        out.append(80, '-');
+        out += '\n';
+        for (const auto &copy: copies) {
+            appendPadded(out, copy.branch, 15);
+            appendPadded(out, copy.title, 20);
+            appendPadded(out, copy.author, 20);
+            appendPadded(out, copy.isbn, 15);
+            out += to_string(copy.available) + " of " + to_string(copy.inventory) + '\n';
+        }
+        cout << out;
+    }
+
+    void switchBranch() {
+        cout << endl << "Branches:";
+        for (size_t b = 0; b < network.branchCount(); ++b) {
+            cout << ' ' << network.branchName(b);
+        }
+        cout << endl << "Enter branch name:";
+        string name;
+        getline(cin, name);
+
+        optional<size_t> branch = network.findBranch(name);
+        if (!branch) {
+            cout << "Branch " << name << " not found." << endl;
+            return;
+        }
+        current = *branch;
+    }
+
 public:
+    explicit BranchManagementSystem(const vector<string> &names) : network(names) {}
+
+    size_t branchCount() const { return network.branchCount(); }
+
     void run() {
         while (true) {
             // Display menu
@@ -427,30 +576,39 @@ public:
 
             int choice;
             cout << "Enter your choice: ";
-            cin >> choice;
+            if (!(cin >> choice)) { return; }
             cin.ignore(); // Clear the input buffer
 
             switch (choice) {
                 case 1:
-                    library.addBook();
+                    network.withBranch(current, [](Library &library) { library.addBook(); });
                     break;
                 case 2:
-                    library.deleteBook();
+                    network.withBranch(current, [](Library &library) { library.deleteBook(); });
                     break;
                 case 3:
-                    library.displayBooks();
+                    network.withBranch(current, [](Library &library) { library.displayBooks(); });
                     break;
                 case 4:
-                    library.displayTotalBooksCount();
+                    network.withBranch(current, [](Library &library) { library.displayTotalBooksCount(); });
                     break;
                 case 5:
-                    library.borrowBook();
+                    network.withBranch(current, [](Library &library) { library.borrowBook(); });
                     break;
                 case 6:
-                    library.returnBook();
+                    network.withBranch(current, [](Library &library) { library.returnBook(); });
                     break;
                 case 7:
-                    library.displayBookBorrowers();
+                    network.withBranch(current, [](Library &library) { library.displayBookBorrowers(); });
+                    break;
+                case 8:
+                    network.withBranch(current, [](Library &library) { library.searchBooks(); });
+                    break;
+                case 9:
+                    findAvailableCopy();
+                    break;
+                case 10:
+                    switchBranch();
                     break;
                 case 0:
                     cout << endl << "Exiting the Library Management System. Goodbye!" << endl;
@@ -464,8 +622,180 @@ public:
 
 // ==================== Main Function ====================>
 
-int main() {
-    LibraryManagementSystem lms;
+// Usage:
+//   lms                                        interactive library
+//   lms --primary <socket>                     interactive library shipping mutations to replicas
+//   lms --reminders <file|unix:path>           interactive library sending due-soon and overdue
+//                                              reminders as NDJSON batches, one per minute tick
+//   lms --cdc <socket>                         interactive library publishing every mutation to
+//                                              change feed subscribers; events are kept in library_changes.log
+//   lms --follow <socket> [--consumer <name>]  print a change feed's events, resuming after the
+//                                              consumer's last acknowledged offset
+//   lms --shared <region file>                 interactive library sharing its catalog with other lms
+//                                              processes on this host through a memory-mapped file;
+//                                              holds are not available in this mode
+//   lms --watch <ms>                           interactive library applying edits other programs save to
+//                                              library_books.csv, once the file has been quiet for <ms>
+//   lms --replica <socket> [--max-lag-ms <n>]  read-only replica of a primary
+//   lms --shards <n>                           catalog partitioned across n worker processes; a new n
+//                                              re-partitions the shard files of the previous n
+//   lms --branches <a,b,...>                   branch catalogs, each in library_books_<branch>.csv
+//   lms --export <books|loans> [--format <ndjson|csv>] [--columns <a,b,...>] [--output <file>]
+//   lms --import <file>                        bulk import books into the catalog
+//   lms --fine-run <file> [--fees <schedule>]  write overdue loans and their fines as CSV; the
+//                                              schedule is "<after_days>:<cents_per_day>,...[,cap:<cents>]"
+//   --trace <file>                             with any mode, write startup and persistence spans as
+//                                              Chrome Trace Event JSON on exit
+//
+// SIGUSR1 writes latency and memory statistics to stderr and lms_stats.json.
+int main(int argc, char *argv[]) {
+    dumpStatisticsOnSignal(SIGUSR1, "lms_stats.json");
+
+    string primary_socket, replica_socket, import_path, reminder_sink, fine_run_path, fee_spec;
+    string cdc_socket, follow_socket, consumer = "lms", shared_region;
+    string export_table, export_format = "ndjson", export_columns, export_output = "-";
+    int64_t max_lag_ms = 2000;
+    int watch_settle_ms = -1;
+    size_t shard_count = 0;
+    vector<string> branch_names;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--primary") {
+            primary_socket = argv[i + 1];
+        } else if (option == "--cdc") {
+            cdc_socket = argv[i + 1];
+        } else if (option == "--follow") {
+            follow_socket = argv[i + 1];
+        } else if (option == "--consumer") {
+            consumer = argv[i + 1];
+        } else if (option == "--shared") {
+            shared_region = argv[i + 1];
+        } else if (option == "--watch") {
+            watch_settle_ms = stoi(argv[i + 1]);
+        } else if (option == "--reminders") {
+            reminder_sink = argv[i + 1];
+        } else if (option == "--replica") {
+            replica_socket = argv[i + 1];
+        } else if (option == "--max-lag-ms") {
+            max_lag_ms = stoll(argv[i + 1]);
+        } else if (option == "--shards") {
+            shard_count = stoull(argv[i + 1]);
+        } else if (option == "--branches") {
+            istringstream ss(argv[i + 1]);
+            string name;
+            while (getline(ss, name, ',')) {
+                branch_names.push_back(name);
+            }
+        } else if (option == "--export") {
+            export_table = argv[i + 1];
+        } else if (option == "--format") {
+            export_format = argv[i + 1];
+        } else if (option == "--columns") {
+            export_columns = argv[i + 1];
+        } else if (option == "--output") {
+            export_output = argv[i + 1];
+        } else if (option == "--fine-run") {
+            fine_run_path = argv[i + 1];
+        } else if (option == "--fees") {
+            fee_spec = argv[i + 1];
+        } else if (option == "--import") {
+            import_path = argv[i + 1];
+        } else if (option == "--trace") {
+            Tracer::instance().enable(argv[i + 1]);
+        }
+    }
+
+    if (!import_path.empty()) {
+        Library library;
+        ImportReport report = library.importBooks(import_path);
+        Library::displayImportReport(report);
+        return report.imported > 0 || report.rejects.empty() ? 0 : 1;
+    }
+
+    if (!follow_socket.empty()) {
+        bool connected = followChangeFeed(follow_socket, consumer, 1000, [](const Mutation &event) {
+            cout << event.toString() << endl;
+        });
+        if (!connected) {
+            cerr << "Error: Unable to connect to change feed " << follow_socket << "." << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!fine_run_path.empty()) {
+        optional<FeeSchedule> schedule = fee_spec.empty() ? FeeSchedule() : FeeSchedule::parse(fee_spec);
+        if (!schedule) {
+            cerr << "Error: Invalid fee schedule." << endl;
+            return 1;
+        }
+
+        Library library;
+        LoanBatch batch(library.getBooks());
+        FineSummary summary = batch.run(time(nullptr), *schedule);
+        if (!batch.writeCsv(fine_run_path, library.getBooks())) {
+            cerr << "Error: Unable to write " << fine_run_path << "." << endl;
+            return 1;
+        }
+        cerr << summary.overdue << " of " << summary.loans << " loans overdue, fines total " << summary.total_cents / 100
+                << '.' << setfill('0') << setw(2) << summary.total_cents % 100 << endl;
+        return 0;
+    }
+
+    if (!export_table.empty()) {
+        ExportTable table;
+        ExportFormat format;
+        vector<const ExportColumn *> columns;
+        if (!CatalogExporter::parseTable(export_table, table) || !CatalogExporter::parseFormat(export_format, format) ||
+            !CatalogExporter::selectColumns(table, export_columns, columns)) {
+            cerr << "Error: Invalid export options." << endl;
+            return 1;
+        }
+
+        ExportStats stats = CatalogExporter::exportTo(export_output, Library().getBooks(), table, format, columns);
+        cerr << stats.toString() << endl;
+        return stats.ok ? 0 : 1;
+    }
+
+    if (shard_count > 0) {
+        ShardedManagementSystem sharded(shard_count);
+        sharded.run();
+        return 0;
+    }
+
+    if (!branch_names.empty()) {
+        BranchManagementSystem branches(branch_names);
+        if (branches.branchCount() == 0) {
+            cerr << "Error: Branch names may only use letters, digits, '-' and '_'." << endl;
+            return 1;
+        }
+        branches.run();
+        return 0;
+    }
+
+    if (!replica_socket.empty()) {
+        ReplicaManagementSystem replica(replica_socket, max_lag_ms);
+        replica.run();
+        return 0;
+    }
+
+    optional<TraceSpan> startup(in_place, "startup");
+    LibraryManagementSystem lms(shared_region);
+    startup.reset();
+    if (!lms.isCatalogReady()) { return 1; }
+    if (!primary_socket.empty()) {
+        lms.startReplication(primary_socket);
+    }
+    if (!reminder_sink.empty()) {
+        lms.startReminders(reminder_sink);
+    }
+    if (!cdc_socket.empty()) {
+        lms.startChangeFeed(cdc_socket);
+    }
+    if (watch_settle_ms >= 0) {
+        lms.startWatching(watch_settle_ms);
+    }
     lms.run();
 
     return 0;
@@ -0,0 +1,380 @@
+#ifndef LMS_METRICS_H
+#define LMS_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+
+#include "tracing.h"
+
+using namespace std;
+
+// ==================== Latency Metrics ====================>
+
+// Operations and persistence phases whose latency is recorded
+enum class LatencyMetric {
+    ADD, DELETE, BORROW, RETURN,
+    SAVE, SAVE_SERIALIZE, SAVE_WRITE, SAVE_FLUSH,
+    LOAD, LOAD_READ, LOAD_PARSE, LOAD_INDEX,
+    RELOAD,
+    COUNT
+};
+
+inline const char *latencyMetricName(LatencyMetric metric) {
+    static const char *names[] = {
+        "add", "delete", "borrow", "return",
+        "save", "save.serialize", "save.write", "save.flush",
+        "load", "load.read", "load.parse", "load.index",
+        "reload",
+    };
+    return names[size_t(metric)];
+}
+
+// Percentile summary of one metric, in nanoseconds
+struct LatencySummary {
+    uint64_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+// HDR-style log-linear latency histograms. Values below 128 ns get exact buckets; above that,
+// each power of two is split into 64 buckets (under 1.6% relative error) up to about 18 minutes.
+//
+// Every thread records into its own bucket arrays with plain relaxed stores (no shared cache
+// lines, no read-modify-write), and a summary merges all threads' arrays on demand.
+class LatencyHistograms {
+    static constexpr int SUB_BITS = 6;
+    static constexpr uint64_t SUB = 1 << SUB_BITS;
+    static constexpr int MAX_EXPONENT = 40 - SUB_BITS;
+    static constexpr size_t BUCKETS = (MAX_EXPONENT + 2) * SUB;
+    static constexpr size_t METRICS = size_t(LatencyMetric::COUNT);
+
+    using Buckets = array<array<atomic<uint64_t>, BUCKETS>, METRICS>;
+
+    mutex registry_mutex;
+    vector<unique_ptr<Buckets>> threads; // kept after a thread exits so its samples still count
+
+    static size_t bucketOf(uint64_t nanos) {
+        if (nanos < 2 * SUB) { return size_t(nanos); }
+        int exponent = min(63 - __builtin_clzll(nanos) - SUB_BITS, MAX_EXPONENT);
+        uint64_t sub = min(nanos >> exponent, 2 * SUB - 1);
+        return size_t((exponent + 1) * SUB + (sub - SUB));
+    }
+
+    // Midpoint of a bucket's value range
+    static uint64_t valueOf(size_t bucket) {
+        if (bucket < 2 * SUB) { return bucket; }
+        int exponent = int(bucket / SUB) - 1;
+        uint64_t lowest = (bucket % SUB + SUB) << exponent;
+        return lowest + (uint64_t(1) << exponent) / 2;
+    }
+
+    Buckets &localBuckets() {
+        thread_local Buckets *local = nullptr;
+        if (!local) {
+            auto buckets = make_unique<Buckets>();
+            for (auto &metric: *buckets) {
+                for (auto &count: metric) {
+                    count.store(0, memory_order_relaxed);
+                }
+            }
+            lock_guard<mutex> lock(registry_mutex);
+            local = buckets.get();
+            threads.push_back(std::move(buckets));
+        }
+        return *local;
+    }
+
+    // Merged bucket counts of a metric across threads
+    vector<uint64_t> merged(LatencyMetric metric) {
+        vector<uint64_t> counts(BUCKETS);
+        lock_guard<mutex> lock(registry_mutex);
+        for (const auto &buckets: threads) {
+            const auto &source = (*buckets)[size_t(metric)];
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                counts[b] += source[b].load(memory_order_relaxed);
+            }
+        }
+        return counts;
+    }
+
+public:
+    static LatencyHistograms &instance() {
+        static LatencyHistograms histograms;
+        return histograms;
+    }
+
+    void record(LatencyMetric metric, uint64_t nanos) {
+        atomic<uint64_t> &count = localBuckets()[size_t(metric)][bucketOf(nanos)];
+        count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    LatencySummary summary(LatencyMetric metric) {
+        vector<uint64_t> counts = merged(metric);
+        LatencySummary summary;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            summary.count += counts[b];
+            if (counts[b] > 0) { summary.max = valueOf(b); }
+        }
+        if (summary.count == 0) { return summary; }
+
+        // Smallest bucket whose cumulative count reaches each percentile rank
+        uint64_t p50_rank = (summary.count * 500 + 999) / 1000;
+        uint64_t p99_rank = (summary.count * 990 + 999) / 1000;
+        uint64_t p999_rank = (summary.count * 999 + 999) / 1000;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            if (counts[b] == 0) { continue; }
+            seen += counts[b];
+            if (summary.p50 == 0 && seen >= p50_rank) { summary.p50 = valueOf(b); }
+            if (summary.p99 == 0 && seen >= p99_rank) { summary.p99 = valueOf(b); }
+            if (summary.p999 == 0 && seen >= p999_rank) { summary.p999 = valueOf(b); }
+        }
+        return summary;
+    }
+
+    // Table of p50/p99/p999/max in microseconds for every metric with samples
+    string summaryTable() {
+        ostringstream oss;
+        oss << left << setw(18) << "Operation" << right << setw(10) << "Count" << setw(12) << "p50 (us)"
+                << setw(12) << "p99 (us)" << setw(12) << "p999 (us)" << setw(12) << "max (us)" << '\n';
+        oss << string(76, '-') << '\n' << fixed << setprecision(1);
+        for (size_t m = 0; m < METRICS; ++m) {
+            LatencySummary s = summary(LatencyMetric(m));
+            if (s.count == 0) { continue; }
+            oss << left << setw(18) << latencyMetricName(LatencyMetric(m)) << right << setw(10) << s.count
+                    << setw(12) << s.p50 / 1e3 << setw(12) << s.p99 / 1e3 << setw(12) << s.p999 / 1e3
+                    << setw(12) << s.max / 1e3 << '\n';
+        }
+        return oss.str();
+    }
+
+    // Summaries as a JSON object keyed by metric name, values in nanoseconds
+    string toJson() {
+        string json = "{";
+        for (size_t m = 0; m < METRICS; ++m) {
+            LatencySummary s = summary(LatencyMetric(m));
+            if (json.size() > 1) { json += ","; }
+            json += "\"" + string(latencyMetricName(LatencyMetric(m))) + "\":{\"count\":" + to_string(s.count) +
+                    ",\"p50_ns\":" + to_string(s.p50) + ",\"p99_ns\":" + to_string(s.p99) +
+                    ",\"p999_ns\":" + to_string(s.p999) + ",\"max_ns\":" + to_string(s.max) + "}";
+        }
+        return json + "}";
+    }
+};
+
+// Records the lifetime of a scope into a latency metric, and as a trace span when tracing is on
+class LatencyTimer {
+    LatencyMetric metric;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit LatencyTimer(LatencyMetric metric) : metric(metric), start(chrono::steady_clock::now()) {}
+
+    ~LatencyTimer() {
+        auto end = chrono::steady_clock::now();
+        LatencyHistograms::instance().record(metric, uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count()));
+
+        Tracer &tracer = Tracer::instance();
+        if (tracer.isEnabled()) { tracer.record(latencyMetricName(metric), start, end); }
+    }
+};
+
+// ==================== Memory Accounting ====================>
+
+// Subsystems whose heap usage is accounted
+enum class MemorySubsystem {
+    BOOKS, BOOK_STRINGS, BORROWERS, INDEX, BUFFERS, LEDGER,
+    COUNT
+};
+
+inline const char *memorySubsystemName(MemorySubsystem subsystem) {
+    static const char *names[] = {"books", "book_strings", "borrowers", "index", "buffers", "ledger"};
+    return names[size_t(subsystem)];
+}
+
+struct MemoryUsage {
+    uint64_t live_bytes = 0;
+    uint64_t peak_bytes = 0;
+    uint64_t allocations = 0;
+};
+
+// Process-wide live/peak bytes and allocation counts per subsystem
+class MemoryAccounting {
+    static constexpr size_t SUBSYSTEMS = size_t(MemorySubsystem::COUNT);
+
+    struct Counters {
+        atomic<uint64_t> live_bytes{0};
+        atomic<uint64_t> peak_bytes{0};
+        atomic<uint64_t> allocations{0};
+    };
+
+    array<Counters, SUBSYSTEMS> counters;
+
+public:
+    static MemoryAccounting &instance() {
+        static MemoryAccounting accounting;
+        return accounting;
+    }
+
+    void allocated(MemorySubsystem subsystem, size_t bytes) {
+        Counters &c = counters[size_t(subsystem)];
+        c.allocations.fetch_add(1, memory_order_relaxed);
+        uint64_t live = c.live_bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+        uint64_t peak = c.peak_bytes.load(memory_order_relaxed);
+        while (live > peak && !c.peak_bytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+    }
+
+    void released(MemorySubsystem subsystem, size_t bytes) {
+        counters[size_t(subsystem)].live_bytes.fetch_sub(bytes, memory_order_relaxed);
+    }
+
+    MemoryUsage usage(MemorySubsystem subsystem) const {
+        const Counters &c = counters[size_t(subsystem)];
+        return {c.live_bytes.load(memory_order_relaxed), c.peak_bytes.load(memory_order_relaxed),
+                c.allocations.load(memory_order_relaxed)};
+    }
+
+    // Table of live/peak KiB and allocation counts for every subsystem
+    string summaryTable() const {
+        ostringstream oss;
+        oss << left << setw(18) << "Subsystem" << right << setw(14) << "Live (KiB)" << setw(14) << "Peak (KiB)"
+                << setw(14) << "Allocations" << '\n';
+        oss << string(60, '-') << '\n' << fixed << setprecision(1);
+        for (size_t i = 0; i < SUBSYSTEMS; ++i) {
+            MemoryUsage u = usage(MemorySubsystem(i));
+            oss << left << setw(18) << memorySubsystemName(MemorySubsystem(i)) << right << setw(14)
+                    << u.live_bytes / 1024.0 << setw(14) << u.peak_bytes / 1024.0 << setw(14) << u.allocations << '\n';
+        }
+        return oss.str();
+    }
+
+    // Usage as a JSON object keyed by subsystem name
+    string toJson() const {
+        string json = "{";
+        for (size_t i = 0; i < SUBSYSTEMS; ++i) {
+            MemoryUsage u = usage(MemorySubsystem(i));
+            if (json.size() > 1) { json += ","; }
+            json += "\"" + string(memorySubsystemName(MemorySubsystem(i))) + "\":{\"live_bytes\":" +
+                    to_string(u.live_bytes) + ",\"peak_bytes\":" + to_string(u.peak_bytes) + ",\"allocations\":" +
+                    to_string(u.allocations) + "}";
+        }
+        return json + "}";
+    }
+};
+
+// Standard allocator that accounts its allocations to a subsystem
+template<class T, MemorySubsystem Subsystem>
+struct TrackingAllocator {
+    using value_type = T;
+
+    template<class U>
+    struct rebind {
+        using other = TrackingAllocator<U, Subsystem>;
+    };
+
+    TrackingAllocator() = default;
+
+    template<class U>
+    TrackingAllocator(const TrackingAllocator<U, Subsystem> &) {}
+
+    T *allocate(size_t n) {
+        MemoryAccounting::instance().allocated(Subsystem, n * sizeof(T));
+        return allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) {
+        MemoryAccounting::instance().released(Subsystem, n * sizeof(T));
+        allocator<T>().deallocate(p, n);
+    }
+
+    template<class U>
+    bool operator==(const TrackingAllocator<U, Subsystem> &) const { return true; }
+};
+
+// String whose heap buffer is accounted to I/O buffers
+using BufferString = basic_string<char, char_traits<char>, TrackingAllocator<char, MemorySubsystem::BUFFERS>>;
+
+// Heap bytes behind a std::string, zero while it fits the small-string buffer
+inline size_t stringHeapBytes(const string &str) {
+    static const size_t inline_capacity = string().capacity();
+    return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+// Accounts heap owned by plain members (such as strings) to a subsystem for the owner's lifetime.
+// Copies charge the same size again; moves transfer the charge.
+template<MemorySubsystem Subsystem>
+class MemoryCharge {
+    size_t bytes = 0;
+
+public:
+    MemoryCharge() = default;
+    MemoryCharge(const MemoryCharge &other) { set(other.bytes); }
+    MemoryCharge(MemoryCharge &&other) noexcept : bytes(exchange(other.bytes, 0)) {}
+
+    MemoryCharge &operator=(const MemoryCharge &other) {
+        if (this != &other) { set(other.bytes); }
+        return *this;
+    }
+
+    MemoryCharge &operator=(MemoryCharge &&other) noexcept {
+        if (this != &other) {
+            set(0);
+            bytes = exchange(other.bytes, 0);
+        }
+        return *this;
+    }
+
+    ~MemoryCharge() { set(0); }
+
+    // Replace the charged size; a non-zero charge counts as one allocation
+    void set(size_t new_bytes) {
+        MemoryAccounting &accounting = MemoryAccounting::instance();
+        if (bytes > 0) { accounting.released(Subsystem, bytes); }
+        if (new_bytes > 0) { accounting.allocated(Subsystem, new_bytes); }
+        bytes = new_bytes;
+    }
+};
+
+// Latency and memory statistics as one JSON object
+inline string statisticsJson() {
+    return "{\"latency\":" + LatencyHistograms::instance().toJson() + ",\"memory\":" +
+           MemoryAccounting::instance().toJson() + "}";
+}
+
+// Write latency and memory statistics when the process receives `signal`: the tables to stderr and
+// the JSON to json_path. Call before starting other threads so they all inherit the blocked signal mask.
+inline void dumpStatisticsOnSignal(int signal, const string &json_path) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, signal);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    thread([signals, json_path] {
+        while (true) {
+            int received;
+            if (sigwait(&signals, &received) != 0) { return; }
+
+            cerr << endl << LatencyHistograms::instance().summaryTable() << endl
+                    << MemoryAccounting::instance().summaryTable() << flush;
+            ofstream(json_path) << statisticsJson() << endl;
+        }
+    }).detach();
+}
+
+#endif //LMS_METRICS_H
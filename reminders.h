@@ -0,0 +1,431 @@
+#ifndef LMS_REMINDERS_H
+#define LMS_REMINDERS_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+#include "sockets.h"
+
+// ==================== Timer Wheel ====================>
+
+// Hierarchical hashed timer wheel over integer ticks.
+//
+// LEVELS wheels of SLOTS buckets each: level 0 holds timers due within SLOTS ticks, level L those
+// due within SLOTS^(L+1) ticks, and timers further out wait in the last level. Whenever a lower
+// wheel wraps, the next bucket of the wheel above is cascaded down. Timers are nodes of a slot map
+// linked into their bucket, so scheduling and cancelling are O(1) and a tick only touches the
+// timers that fire or cascade.
+class TimerWheel {
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        uint32_t generation = 0; // odd while the timer is pending
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+        uint32_t bucket = 0;
+        uint64_t expires = 0;
+        uint32_t payload = 0;
+    };
+
+    vector<Node> nodes;
+    vector<uint32_t> free_nodes;
+    array<uint32_t, LEVELS * SLOTS> buckets;
+    uint64_t current;
+    size_t pending = 0;
+
+    void link(uint32_t index) {
+        Node &node = nodes[index];
+        uint64_t expires = max(node.expires, current);
+        uint64_t delta = expires - current;
+
+        unsigned level = 0;
+        while (level + 1 < LEVELS && delta >= uint64_t(1) << (SLOT_BITS * (level + 1))) {
+            ++level;
+        }
+        if (delta >= uint64_t(1) << (SLOT_BITS * LEVELS)) {
+            expires = current + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1; // park in the last level
+        }
+
+        node.bucket = level * SLOTS + uint32_t(expires >> (SLOT_BITS * level)) % SLOTS;
+        node.prev = NONE;
+        node.next = buckets[node.bucket];
+        if (node.next != NONE) { nodes[node.next].prev = index; }
+        buckets[node.bucket] = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node &node = nodes[index];
+        (node.prev == NONE ? buckets[node.bucket] : nodes[node.prev].next) = node.next;
+        if (node.next != NONE) { nodes[node.next].prev = node.prev; }
+    }
+
+    void release(uint32_t index) {
+        ++nodes[index].generation;
+        free_nodes.push_back(index);
+        --pending;
+    }
+
+    // Detach a bucket and re-link its timers relative to the current tick
+    void cascade(unsigned level, uint32_t slot) {
+        uint32_t index = exchange(buckets[level * SLOTS + slot], NONE);
+        while (index != NONE) {
+            uint32_t next = nodes[index].next;
+            link(index);
+            index = next;
+        }
+    }
+
+public:
+    using Handle = SlotHandle;
+
+    explicit TimerWheel(uint64_t start_tick = 0) : current(start_tick) {
+        buckets.fill(NONE);
+    }
+
+    uint64_t currentTick() const { return current; }
+    size_t size() const { return pending; }
+
+    // Schedule a timer; ticks at or before the current one fire on the next advance
+    Handle schedule(uint64_t tick, uint32_t payload) {
+        uint32_t index;
+        if (free_nodes.empty()) {
+            index = uint32_t(nodes.size());
+            nodes.emplace_back();
+        } else {
+            index = free_nodes.back();
+            free_nodes.pop_back();
+        }
+
+        Node &node = nodes[index];
+        ++node.generation;
+        node.expires = tick;
+        node.payload = payload;
+        link(index);
+        ++pending;
+        return {index, node.generation};
+    }
+
+    bool cancel(Handle handle) {
+        if (handle.index >= nodes.size() || !(handle.generation & 1) || nodes[handle.index].generation != handle.generation) {
+            return false;
+        }
+
+        unlink(handle.index);
+        release(handle.index);
+        return true;
+    }
+
+    // Move the wheel to `tick`, calling fire(tick, payload) for every timer that expires on the way.
+    // Timers already due fire at the first tick processed.
+    template<typename Fire>
+    void advance(uint64_t tick, Fire &&fire) {
+        while (current <= tick) {
+            if (current % SLOTS == 0) {
+                for (unsigned level = 1; level < LEVELS; ++level) {
+                    uint32_t slot = uint32_t(current >> (SLOT_BITS * level)) % SLOTS;
+                    cascade(level, slot);
+                    if (slot != 0) { break; }
+                }
+            }
+
+            uint32_t index = exchange(buckets[current % SLOTS], NONE);
+            while (index != NONE) {
+                uint32_t next = nodes[index].next;
+                if (nodes[index].expires <= current) {
+                    uint32_t payload = nodes[index].payload;
+                    release(index);
+                    fire(current, payload);
+                } else {
+                    link(index); // parked beyond the wheel's range
+                }
+                index = next;
+            }
+            ++current;
+        }
+    }
+};
+
+// ==================== Due Date Reminders ====================>
+
+// A reminder for one loan
+struct ReminderEvent {
+    enum Type { DUE_SOON, OVERDUE };
+
+    Type type;
+    string isbn;
+    Borrower borrower;
+
+    // One NDJSON line
+    string toJson() const {
+        string json = "{\"event\":\"";
+        json += type == DUE_SOON ? "due_soon" : "overdue";
+        json += "\",\"isbn\":";
+        appendJsonString(json, isbn);
+        json += ",\"name\":";
+        appendJsonString(json, borrower.getName());
+        json += ",\"mobile\":";
+        appendJsonString(json, borrower.getMobile());
+        json += ",\"email\":";
+        appendJsonString(json, borrower.getEmail());
+        json += ",\"return_date\":\"" + borrower.getReturnDateStr() + "\"}";
+        return json;
+    }
+
+    static void appendJsonString(string &out, const string &value) {
+        out += '"';
+        for (char c: value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (uint8_t(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+};
+
+// Receives the reminders fired in one tick; returns false if they could not be delivered
+using ReminderSink = function<bool(time_t tick_time, const vector<ReminderEvent> &batch)>;
+
+// Append each batch as NDJSON lines to a file
+inline ReminderSink fileReminderSink(const string &path) {
+    return [path](time_t, const vector<ReminderEvent> &batch) {
+        string out;
+        for (const auto &event: batch) {
+            out += event.toJson();
+            out += '\n';
+        }
+        ofstream outFile(path, ios::binary | ios::app);
+        outFile.write(out.data(), streamsize(out.size()));
+        return bool(outFile);
+    };
+}
+
+// Send each batch as NDJSON lines to a Unix stream socket, reconnecting after failures
+inline ReminderSink socketReminderSink(const string &path) {
+    auto fd = make_shared<int>(-1);
+    return [path, fd](time_t, const vector<ReminderEvent> &batch) {
+        string out;
+        for (const auto &event: batch) {
+            out += event.toJson();
+            out += '\n';
+        }
+
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (*fd < 0) {
+                *fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                sockaddr_un addr = unixAddress(path);
+                if (*fd < 0 || connect(*fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+                    if (*fd >= 0) { close(*fd); }
+                    *fd = -1;
+                    return false;
+                }
+            }
+            if (sendAll(*fd, out)) { return true; }
+            close(*fd);
+            *fd = -1;
+        }
+        return false;
+    };
+}
+
+// "unix:<path>" for a socket sink, anything else is a file path
+inline ReminderSink parseReminderSink(const string &spec) {
+    return spec.rfind("unix:", 0) == 0 ? socketReminderSink(spec.substr(5)) : fileReminderSink(spec);
+}
+
+// Fires "due soon" and "overdue" reminders for active loans.
+//
+// Every loan gets two timers on a TimerWheel with one-minute ticks: DUE_SOON_SECONDS before its
+// return date and one tick after it. Borrows schedule them and returns cancel them through the
+// library's mutation stream, so a return costs a hash lookup and two O(1) cancellations; deleting
+// a book cancels the timers of its loans. The reminders fired in a tick are handed to the sink as
+// one batch.
+class ReminderScheduler {
+public:
+    static constexpr time_t TICK_SECONDS = 60;
+    static constexpr time_t DUE_SOON_SECONDS = 24 * 60 * 60;
+
+private:
+    struct Loan {
+        string isbn;
+        Borrower borrower;
+        TimerWheel::Handle due_soon;
+        TimerWheel::Handle overdue;
+        int timers = 0;
+    };
+
+    mutex scheduler_mutex;
+    TimerWheel wheel;
+    vector<optional<Loan>> loans;
+    vector<uint32_t> free_loans;
+    unordered_multimap<string, uint32_t> loan_ids; // isbn + the loan as recorded, copy included -> loan
+    ReminderSink sink;
+    uint64_t delivered = 0;
+    uint64_t failed = 0;
+
+    thread ticker;
+    atomic<bool> stopping{false};
+    mutex stop_mutex;
+    condition_variable stop_requested;
+
+    // A patron may hold several copies of a title, so the loan's dates and copy are part of the key
+    static string loanKey(const string &isbn, const Borrower &borrower) { return isbn + '\t' + borrower.toString(); }
+
+    static uint64_t tickOf(time_t time) { return uint64_t(max<time_t>(time, 0) / TICK_SECONDS); }
+
+    void scheduleLoan(const string &isbn, const Borrower &borrower, time_t now) {
+        uint32_t id;
+        if (free_loans.empty()) {
+            id = uint32_t(loans.size());
+            loans.emplace_back();
+        } else {
+            id = free_loans.back();
+            free_loans.pop_back();
+        }
+
+        Loan &loan = loans[id].emplace(Loan{isbn, borrower, {}, {}, 0});
+        time_t due = borrower.getReturnDate();
+        if (due > now) { // loans already inside the window are reminded on the next tick
+            loan.due_soon = wheel.schedule(tickOf(due - DUE_SOON_SECONDS), id << 1 | ReminderEvent::DUE_SOON);
+            ++loan.timers;
+        }
+        loan.overdue = wheel.schedule(tickOf(due) + 1, id << 1 | ReminderEvent::OVERDUE);
+        ++loan.timers;
+        loan_ids.emplace(loanKey(isbn, borrower), id);
+    }
+
+    void releaseLoan(uint32_t id) {
+        const Loan &loan = *loans[id];
+        auto range = loan_ids.equal_range(loanKey(loan.isbn, loan.borrower));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == id) {
+                loan_ids.erase(it);
+                break;
+            }
+        }
+        loans[id].reset();
+        free_loans.push_back(id);
+    }
+
+    void cancelLoan(const string &isbn, const Borrower &borrower) {
+        auto it = loan_ids.find(loanKey(isbn, borrower));
+        if (it == loan_ids.end()) { return; }
+
+        cancelTimers(it->second);
+    }
+
+    void cancelTimers(uint32_t id) {
+        wheel.cancel(loans[id]->due_soon);
+        wheel.cancel(loans[id]->overdue);
+        releaseLoan(id);
+    }
+
+    // Cancel the timers of every loan of a deleted book
+    void cancelBook(const string &isbn) {
+        for (uint32_t id = 0; id < loans.size(); ++id) {
+            if (loans[id] && loans[id]->isbn == isbn) { cancelTimers(id); }
+        }
+    }
+
+public:
+    explicit ReminderScheduler(ReminderSink sink, time_t now = time(nullptr)) : wheel(tickOf(now)), sink(std::move(sink)) {}
+
+    ~ReminderScheduler() { stop(); }
+
+    // Schedule reminders for every loan in the catalog
+    void populate(const Library &library, time_t now = time(nullptr)) {
+        lock_guard<mutex> lock(scheduler_mutex);
+        for (const auto &book: library.getBooks()) {
+            for (const auto &borrower: book.getBorrowers()) {
+                scheduleLoan(book.getISBN(), borrower, now);
+            }
+        }
+    }
+
+    // Keep the timers in step with borrows, returns and deleted books
+    void onMutation(const Mutation &mutation) {
+        lock_guard<mutex> lock(scheduler_mutex);
+        switch (mutation.type) {
+            case Mutation::BORROW:
+                scheduleLoan(mutation.isbn, Borrower::fromString(mutation.payload), time(nullptr));
+                break;
+            case Mutation::RETURN:
+                cancelLoan(mutation.isbn, Borrower::fromString(mutation.payload));
+                break;
+            case Mutation::DELETE:
+                cancelBook(mutation.isbn);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Fire the timers due up to `now`, delivering one batch per tick that has reminders
+    void advance(time_t now) {
+        vector<pair<time_t, vector<ReminderEvent>>> batches;
+        {
+            lock_guard<mutex> lock(scheduler_mutex);
+            wheel.advance(tickOf(now), [&](uint64_t tick, uint32_t payload) {
+                uint32_t id = payload >> 1;
+                Loan &loan = *loans[id];
+                time_t tick_time = time_t(tick) * TICK_SECONDS;
+                if (batches.empty() || batches.back().first != tick_time) { batches.emplace_back(tick_time, vector<ReminderEvent>()); }
+                batches.back().second.push_back({ReminderEvent::Type(payload & 1), loan.isbn, loan.borrower});
+                if (--loan.timers == 0) { releaseLoan(id); }
+            });
+        }
+
+        for (const auto &[tick_time, batch]: batches) {
+            bool ok = sink(tick_time, batch);
+            lock_guard<mutex> lock(scheduler_mutex);
+            (ok ? delivered : failed) += batch.size();
+        }
+    }
+
+    // Advance with the clock on a background thread every `interval_seconds`
+    void start(int interval_seconds = int(TICK_SECONDS)) {
+        ticker = thread([this, interval_seconds] {
+            unique_lock<mutex> lock(stop_mutex);
+            while (!stopping) {
+                lock.unlock();
+                advance(time(nullptr));
+                lock.lock();
+                stop_requested.wait_for(lock, chrono::seconds(interval_seconds), [this] { return stopping.load(); });
+            }
+        });
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> lock(stop_mutex);
+            stopping = true;
+        }
+        stop_requested.notify_all();
+        if (ticker.joinable()) { ticker.join(); }
+    }
+
+    size_t pendingTimers() {
+        lock_guard<mutex> lock(scheduler_mutex);
+        return wheel.size();
+    }
+
+    // Reminders handed to the sink, and those the sink could not deliver
+    pair<uint64_t, uint64_t> deliveryCounts() {
+        lock_guard<mutex> lock(scheduler_mutex);
+        return {delivered, failed};
+    }
+};
+
+#endif //LMS_REMINDERS_H
@@ -0,0 +1,324 @@
+#ifndef LMS_REPLICATION_H
+#define LMS_REPLICATION_H
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "sockets.h"
+
+// ==================== Replication Primary ====================>
+
+// Ships the mutation stream of a library to replicas connected on a Unix socket.
+//
+// Protocol (one record per line):
+//   replica -> primary: HELLO <epoch> <applied seq>
+//   primary -> replica: SNAPSHOT <epoch> <seq> <count>, then <count> Book::toString lines
+//                       M <Mutation::toString>
+//                       H <head seq> <primary time ms>  (heartbeat, sent after every record up to head)
+class ReplicationPrimary {
+    static constexpr int HEARTBEAT_MS = 200;
+
+    string socket_path;
+    int listen_fd = -1;
+    uint64_t epoch;
+    size_t max_log_size;
+
+    mutex log_mutex;
+    condition_variable log_changed;
+    vector<string> snapshot_lines;
+    uint64_t snapshot_seq = 0;
+    deque<Mutation> log;
+    uint64_t head_seq = 0;
+    atomic<bool> stopping{false};
+
+    mutex replicas_mutex;
+    vector<int> replica_fds;
+    vector<thread> replica_threads;
+    thread accept_thread;
+
+    void acceptLoop() {
+        while (!stopping) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) { continue; }
+
+            lock_guard<mutex> lock(replicas_mutex);
+            if (stopping) {
+                close(fd);
+                break;
+            }
+            replica_fds.push_back(fd);
+            replica_threads.emplace_back(&ReplicationPrimary::serveReplica, this, fd);
+        }
+    }
+
+    void serveReplica(int fd) {
+        streamToReplica(fd);
+
+        lock_guard<mutex> lock(replicas_mutex);
+        for (auto &replica_fd: replica_fds) {
+            if (replica_fd == fd) {
+                close(fd);
+                replica_fd = -1;
+            }
+        }
+    }
+
+    void streamToReplica(int fd) {
+        LineReader reader(fd);
+        string hello;
+        if (!reader.readLine(hello)) { return; }
+
+        string tag;
+        uint64_t replica_epoch = 0, sent_seq = 0;
+        istringstream(hello) >> tag >> replica_epoch >> sent_seq;
+
+        unique_lock<mutex> lock(log_mutex);
+
+        // A replica of another epoch, or one behind the compacted log, starts from a snapshot
+        if (replica_epoch != epoch || sent_seq < snapshot_seq || sent_seq > head_seq) {
+            string out = "SNAPSHOT " + to_string(epoch) + " " + to_string(snapshot_seq) + " " +
+                         to_string(snapshot_lines.size()) + "\n";
+            for (const auto &line: snapshot_lines) {
+                out += line + "\n";
+            }
+            sent_seq = snapshot_seq;
+
+            lock.unlock();
+            if (!sendAll(fd, out)) { return; }
+            lock.lock();
+        }
+
+        while (!stopping) {
+            string out;
+
+            // Records after sent_seq; if compaction dropped them the replica must resync
+            if (sent_seq < snapshot_seq) { break; }
+            for (size_t i = sent_seq - snapshot_seq; i < log.size(); ++i) {
+                out += "M " + log[i].toString() + "\n";
+            }
+            sent_seq = head_seq;
+            out += "H " + to_string(head_seq) + " " + to_string(currentTimeMillis()) + "\n";
+
+            lock.unlock();
+            if (!sendAll(fd, out)) { return; }
+            lock.lock();
+
+            log_changed.wait_for(lock, chrono::milliseconds(HEARTBEAT_MS),
+                                 [&] { return stopping || head_seq != sent_seq; });
+        }
+    }
+
+public:
+    static constexpr size_t MAX_LOG_SIZE = 100000;
+
+    // Start listening; the snapshot is the catalog state at the given sequence number
+    ReplicationPrimary(string socket_path, vector<string> snapshot_lines, uint64_t seq, size_t max_log_size = MAX_LOG_SIZE) {
+        this->socket_path = socket_path;
+        this->max_log_size = max_log_size;
+        this->snapshot_lines = snapshot_lines;
+        this->snapshot_seq = seq;
+        this->head_seq = seq;
+        this->epoch = chrono::steady_clock::now().time_since_epoch().count() ^ getpid();
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = unixAddress(socket_path);
+        unlink(socket_path.c_str());
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr *) &addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+            cerr << "Error: Unable to listen on replication socket " << socket_path << "." << endl;
+            return;
+        }
+
+        accept_thread = thread(&ReplicationPrimary::acceptLoop, this);
+    }
+
+    ~ReplicationPrimary() {
+        stopping = true;
+        log_changed.notify_all();
+
+        if (listen_fd >= 0) {
+            shutdown(listen_fd, SHUT_RDWR);
+            close(listen_fd);
+            unlink(socket_path.c_str());
+        }
+        if (accept_thread.joinable()) { accept_thread.join(); }
+
+        vector<thread> threads;
+        {
+            lock_guard<mutex> lock(replicas_mutex);
+            for (int fd: replica_fds) {
+                if (fd >= 0) { shutdown(fd, SHUT_RDWR); }
+            }
+            threads.swap(replica_threads);
+        }
+        for (auto &replica_thread: threads) {
+            replica_thread.join();
+        }
+    }
+
+    // Append a committed mutation
+    void append(const Mutation &mutation) {
+        lock_guard<mutex> lock(log_mutex);
+        log.push_back(mutation);
+        head_seq = mutation.seq;
+        log_changed.notify_all();
+    }
+
+    // Whether the log has outgrown max_log_size and should be folded into a snapshot
+    bool needsCompaction() {
+        lock_guard<mutex> lock(log_mutex);
+        return log.size() > max_log_size;
+    }
+
+    // Replace the log up to seq with the catalog state at seq. Only call between library operations:
+    // within one, the catalog may already hold changes that are published after the current mutation.
+    void compact(vector<string> lines, uint64_t seq) {
+        lock_guard<mutex> lock(log_mutex);
+        if (seq <= snapshot_seq || seq > head_seq) { return; }
+        log.erase(log.begin(), log.begin() + ptrdiff_t(seq - snapshot_seq));
+        snapshot_lines = std::move(lines);
+        snapshot_seq = seq;
+        log_changed.notify_all();
+    }
+};
+
+// ==================== Replication Replica ====================>
+
+// Read-only copy of a primary's catalog, kept up to date from its mutation stream
+class ReplicaNode {
+    string socket_path;
+    int64_t max_lag_ms;
+
+    mutable shared_mutex library_mutex;
+    Library library{""};
+    uint64_t epoch = 0;
+
+    atomic<uint64_t> applied_seq{0};
+    atomic<uint64_t> primary_seq{0};
+    atomic<int64_t> caught_up_ms{0};
+    atomic<int64_t> apply_delay_ms{0};
+    atomic<bool> connected{false};
+    atomic<bool> stopping{false};
+    atomic<int> socket_fd{-1};
+    thread receive_thread;
+
+    // Connect, resync and apply records until the connection drops, then reconnect
+    void receiveLoop() {
+        while (!stopping) {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr = unixAddress(socket_path);
+            if (fd < 0 || connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+                if (fd >= 0) { close(fd); }
+                this_thread::sleep_for(chrono::milliseconds(500));
+                continue;
+            }
+
+            socket_fd = fd;
+            connected = true;
+            if (sendAll(fd, "HELLO " + to_string(epoch) + " " + to_string(applied_seq) + "\n")) {
+                LineReader reader(fd);
+                string line;
+                while (!stopping && reader.readLine(line)) {
+                    if (!applyLine(line, reader)) { break; }
+                }
+            }
+
+            connected = false;
+            socket_fd = -1;
+            close(fd);
+        }
+    }
+
+    // Apply one protocol line
+    bool applyLine(const string &line, LineReader &reader) {
+        if (line.rfind("M ", 0) == 0) {
+            Mutation mutation = Mutation::fromString(line.substr(2));
+            {
+                unique_lock<shared_mutex> lock(library_mutex);
+                library.applyMutation(mutation);
+            }
+            applied_seq = mutation.seq;
+            apply_delay_ms = currentTimeMillis() - mutation.commit_ms;
+            return true;
+        }
+
+        if (line.rfind("H ", 0) == 0) {
+            uint64_t head;
+            int64_t primary_ms;
+            istringstream(line.substr(2)) >> head >> primary_ms;
+            primary_seq = head;
+            caught_up_ms = primary_ms;
+            return true;
+        }
+
+        if (line.rfind("SNAPSHOT ", 0) == 0) {
+            uint64_t new_epoch, seq;
+            size_t count;
+            istringstream(line.substr(9)) >> new_epoch >> seq >> count;
+
+            vector<string> lines(count);
+            for (auto &book_line: lines) {
+                if (!reader.readLine(book_line)) { return false; }
+            }
+
+            unique_lock<shared_mutex> lock(library_mutex);
+            library.loadSnapshot(lines, seq);
+            epoch = new_epoch;
+            applied_seq = seq;
+            return true;
+        }
+
+        return false;
+    }
+
+public:
+    ReplicaNode(string socket_path, int64_t max_lag_ms) {
+        this->socket_path = socket_path;
+        this->max_lag_ms = max_lag_ms;
+        receive_thread = thread(&ReplicaNode::receiveLoop, this);
+    }
+
+    ~ReplicaNode() {
+        stopping = true;
+        int fd = socket_fd;
+        if (fd >= 0) { shutdown(fd, SHUT_RDWR); }
+        receive_thread.join();
+    }
+
+    // Milliseconds since the replica was last known to be caught up with the primary
+    int64_t lagMillis() const {
+        if (caught_up_ms == 0) { return INT64_MAX; }
+        return max<int64_t>(0, currentTimeMillis() - caught_up_ms);
+    }
+
+    bool isFresh() const { return lagMillis() <= max_lag_ms; }
+
+    uint64_t appliedSeq() const { return applied_seq; }
+
+    // Run a read-only query against the catalog, refusing if the replica lags too far behind
+    bool query(const function<void(Library &)> &reader) {
+        if (!isFresh()) {
+            cout << endl << "Replica is stale (lag " << (caught_up_ms == 0 ? string("unknown") : to_string(lagMillis()) + " ms")
+                    << ", limit " << max_lag_ms << " ms). Please try again later." << endl;
+            return false;
+        }
+
+        shared_lock<shared_mutex> lock(library_mutex);
+        reader(library);
+        return true;
+    }
+
+    // Replication metrics in "name value" text format
+    string metrics() const {
+        return "lms_replica_connected " + to_string(connected ? 1 : 0) + "\n" +
+               "lms_replica_applied_seq " + to_string(applied_seq) + "\n" +
+               "lms_replica_primary_seq " + to_string(primary_seq) + "\n" +
+               "lms_replica_lag_records " + to_string(primary_seq > applied_seq ? primary_seq - applied_seq : 0) + "\n" +
+               "lms_replica_lag_ms " + (caught_up_ms == 0 ? string("-1") : to_string(lagMillis())) + "\n" +
+               "lms_replica_apply_delay_ms " + to_string(apply_delay_ms) + "\n";
+    }
+};
+
+#endif //LMS_REPLICATION_H
@@ -0,0 +1,320 @@
+#ifndef LMS_SHARDING_H
+#define LMS_SHARDING_H
+
+#include <filesystem>
+#include <mutex>
+#include <sys/wait.h>
+
+#include "sockets.h"
+
+// ==================== Sharded Catalog ====================>
+
+// Reply of a shard worker: a status and result lines
+struct ShardResponse {
+    LibraryStatus status = LibraryStatus::OK;
+    vector<string> lines;
+};
+
+// Serve one shard's catalog on a socket until the router hangs up.
+//
+// Requests are "<OP>\t<args...>" lines; replies are "<status> <count>" followed by <count> lines.
+inline void serveShard(int fd, const string &filename) {
+    Library library(filename);
+    LineReader reader(fd);
+    string request;
+
+    while (reader.readLine(request)) {
+        string op, isbn, arg;
+        istringstream ss(request);
+        getline(ss, op, '\t');
+        getline(ss, isbn, '\t');
+        getline(ss, arg);
+
+        ShardResponse response;
+        try {
+            if (op == "ADD") {
+                response.status = library.addBook(Book::fromString(arg));
+            } else if (op == "DELETE") {
+                response.status = library.deleteBook(isbn);
+            } else if (op == "BORROW") {
+                response.status = library.borrowBook(isbn, Borrower::fromString(arg));
+            } else if (op == "RETURN") {
+                response.status = library.returnBook(isbn, Borrower::fromString(arg));
+            } else if (op == "GET") {
+                optional<Book> book = library.getBook(isbn);
+                if (book) {
+                    response.lines.push_back(book->toString());
+                } else {
+                    response.status = LibraryStatus::NOT_FOUND;
+                }
+            } else if (op == "LIST") {
+                response.lines = library.snapshot();
+            } else if (op == "PAGE") {
+                string next_cursor;
+                for (const auto *book: library.getBooksPage(isbn.empty() ? "" : encodeCursor(isbn), stoull(arg), next_cursor)) {
+                    response.lines.push_back(book->toString());
+                }
+            } else if (op == "COUNT") {
+                response.lines.push_back(to_string(library.getBooksCount()));
+            } else if (op == "SEARCH") {
+                for (const auto &book: library.searchBooks(arg)) {
+                    response.lines.push_back(book.toString());
+                }
+            } else {
+                response.status = LibraryStatus::INVALID_REQUEST;
+            }
+        } catch (const exception &) {
+            // A malformed line fails this request only
+            response = ShardResponse();
+            response.status = LibraryStatus::INVALID_REQUEST;
+        }
+
+        string out = to_string(int(response.status)) + " " + to_string(response.lines.size()) + "\n";
+        for (const auto &line: response.lines) {
+            out += line + "\n";
+        }
+        if (!sendAll(fd, out)) { break; }
+    }
+
+    close(fd);
+}
+
+// Partitions books by ISBN hash across worker processes, each owning its own catalog file.
+// Single-book operations go to one shard; listing, counting and search are scattered to all
+// shards at once and gathered, so the workers run them in parallel.
+//
+// The catalog lives in one layout at a time. Starting with a shard count that has no files
+// re-partitions the shard files of the previous count, then removes them; library_books.csv is
+// only partitioned when no shard files exist. Starting is refused when files of several other
+// counts are found, since it is unknown which holds the catalog.
+class ShardRouter {
+    struct Shard {
+        size_t index;
+        pid_t pid;
+        int fd;
+        unique_ptr<LineReader> reader;
+        mutex channel;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+
+    static string shardFilename(size_t index, size_t count) {
+        return "library_books.shard" + to_string(index) + "-of-" + to_string(count) + ".csv";
+    }
+
+    // Shard counts with files in the working directory
+    static set<size_t> shardCountsOnDisk() {
+        set<size_t> counts;
+        error_code error;
+        for (const auto &entry: filesystem::directory_iterator(".", error)) {
+            string name = entry.path().filename().string();
+            size_t index, count;
+            int consumed = 0;
+            if (sscanf(name.c_str(), "library_books.shard%zu-of-%zu.csv%n", &index, &count, &consumed) == 2 &&
+                size_t(consumed) == name.size() && index < count) {
+                counts.insert(count);
+            }
+        }
+        return counts;
+    }
+
+    // Write each shard's part of a catalog (Book::toString lines) to its file with one write
+    static bool writeShardFiles(const vector<string> &lines, size_t count) {
+        vector<string> parts(count);
+        for (const auto &line: lines) {
+            size_t isbn_begin = line.find(',', line.find(',') + 1) + 1;
+            string isbn = line.substr(isbn_begin, line.find(',', isbn_begin) - isbn_begin);
+            string &part = parts[shardOf(isbn, count)];
+            part += line;
+            part += '\n';
+        }
+
+        bool ok = true;
+        for (size_t i = 0; i < count; ++i) {
+            ofstream outFile(shardFilename(i, count), ios::binary);
+            outFile.write(parts[i].data(), streamsize(parts[i].size()));
+            outFile.close();
+            ok = ok && bool(outFile);
+        }
+        return ok;
+    }
+
+    bool sendRequest(Shard &shard, const string &request) {
+        return sendAll(shard.fd, request + "\n");
+    }
+
+    // Read a reply; a worker that hung up is reported, and UNREACHABLE returned
+    ShardResponse receiveResponse(Shard &shard) {
+        ShardResponse response;
+        string header;
+        int status = 0;
+        size_t count = 0;
+        bool ok = shard.reader->readLine(header) && bool(istringstream(header) >> status >> count);
+        response.lines.resize(ok ? count : 0);
+        for (auto &line: response.lines) {
+            ok = ok && shard.reader->readLine(line);
+        }
+        if (!ok) {
+            cerr << "Error: Shard " << shard.index << " is not responding." << endl;
+            response = ShardResponse();
+            response.status = LibraryStatus::UNREACHABLE;
+            return response;
+        }
+
+        response.status = LibraryStatus(status);
+        return response;
+    }
+
+    // Forward a request to the shard owning the ISBN
+    ShardResponse call(const string &isbn, const string &request) {
+        Shard &shard = *shards[shardOf(isbn)];
+        lock_guard<mutex> lock(shard.channel);
+        sendRequest(shard, request);
+        return receiveResponse(shard);
+    }
+
+    // Send a request to every shard, then gather all replies
+    vector<ShardResponse> scatter(const string &request) {
+        vector<unique_lock<mutex>> locks;
+        for (auto &shard: shards) {
+            locks.emplace_back(shard->channel);
+            sendRequest(*shard, request);
+        }
+
+        vector<ShardResponse> responses;
+        for (auto &shard: shards) {
+            responses.push_back(receiveResponse(*shard));
+        }
+        return responses;
+    }
+
+    static vector<Book> toBooks(const vector<ShardResponse> &responses) {
+        vector<Book> books;
+        for (const auto &response: responses) {
+            for (const auto &line: response.lines) {
+                books.push_back(Book::fromString(line));
+            }
+        }
+        return books;
+    }
+
+public:
+    // Start the worker processes; an unsharded catalog is partitioned on first start
+    explicit ShardRouter(size_t shard_count) {
+        bool fresh = true;
+        for (size_t i = 0; i < shard_count; ++i) {
+            fresh = fresh && !ifstream(shardFilename(i, shard_count));
+        }
+        if (fresh) {
+            set<size_t> previous = shardCountsOnDisk();
+            if (previous.size() > 1) {
+                cerr << "Error: Shard files of several shard counts exist; keep only one layout." << endl;
+                exit(1);
+            }
+
+            vector<string> lines;
+            if (previous.empty()) {
+                lines = Library().snapshot();
+            } else {
+                for (size_t i = 0; i < *previous.begin(); ++i) {
+                    vector<string> part = Library(shardFilename(i, *previous.begin())).snapshot();
+                    move(part.begin(), part.end(), back_inserter(lines));
+                }
+            }
+            if (!writeShardFiles(lines, shard_count)) {
+                cerr << "Error: Unable to write shard files." << endl;
+                exit(1);
+            }
+            for (size_t i = 0; !previous.empty() && i < *previous.begin(); ++i) {
+                remove(shardFilename(i, *previous.begin()).c_str());
+            }
+        }
+
+        for (size_t i = 0; i < shard_count; ++i) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+                cerr << "Error: Unable to create shard channel." << endl;
+                exit(1);
+            }
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(fds[0]);
+                for (auto &shard: shards) {
+                    close(shard->fd);
+                }
+                serveShard(fds[1], shardFilename(i, shard_count));
+                _exit(0);
+            }
+
+            close(fds[1]);
+            auto shard = make_unique<Shard>();
+            shard->index = i;
+            shard->pid = pid;
+            shard->fd = fds[0];
+            shard->reader = make_unique<LineReader>(fds[0]);
+            shards.push_back(std::move(shard));
+        }
+    }
+
+    ~ShardRouter() {
+        for (auto &shard: shards) {
+            close(shard->fd);
+            waitpid(shard->pid, nullptr, 0);
+        }
+    }
+
+    size_t shardCount() const { return shards.size(); }
+
+    size_t shardOf(const string &isbn) const { return shardOf(isbn, shards.size()); }
+    static size_t shardOf(const string &isbn, size_t count) { return fnv1a(isbn) % count; }
+
+    LibraryStatus addBook(const Book &book) {
+        return call(book.getISBN(), "ADD\t" + book.getISBN() + "\t" + book.toString()).status;
+    }
+
+    LibraryStatus deleteBook(const string &isbn) {
+        return call(isbn, "DELETE\t" + isbn).status;
+    }
+
+    LibraryStatus borrowBook(const string &isbn, const Borrower &borrower) {
+        return call(isbn, "BORROW\t" + isbn + "\t" + borrower.toString()).status;
+    }
+
+    LibraryStatus returnBook(const string &isbn, const Borrower &borrower) {
+        return call(isbn, "RETURN\t" + isbn + "\t" + borrower.toString()).status;
+    }
+
+    optional<Book> getBook(const string &isbn) {
+        ShardResponse response = call(isbn, "GET\t" + isbn);
+        if (response.status != LibraryStatus::OK || response.lines.empty()) { return nullopt; }
+        return Book::fromString(response.lines[0]);
+    }
+
+    vector<Book> listBooks() { return toBooks(scatter("LIST")); }
+
+    // Books after the cursor in ISBN order: each shard returns its next page and the router merges them
+    vector<Book> listBooksPage(const string &cursor, size_t page_size, string &next_cursor) {
+        string after = decodeCursor(cursor);
+        vector<Book> books = toBooks(scatter("PAGE\t" + after + "\t" + to_string(page_size + 1)));
+
+        sort(books.begin(), books.end(), [](const Book &a, const Book &b) { return a.getISBN() < b.getISBN(); });
+        bool more = books.size() > page_size;
+        if (more) { books.erase(books.begin() + page_size, books.end()); }
+
+        next_cursor = more ? encodeCursor(books.back().getISBN()) : "";
+        return books;
+    }
+
+    size_t countBooks() {
+        size_t total = 0;
+        for (const auto &response: scatter("COUNT")) {
+            total += response.lines.empty() ? 0 : stoull(response.lines[0]);
+        }
+        return total;
+    }
+
+    vector<Book> searchBooks(const string &text) { return toBooks(scatter("SEARCH\t\t" + text)); }
+};
+
+#endif //LMS_SHARDING_H
@@ -0,0 +1,304 @@
+#ifndef LMS_SHARED_CATALOG_H
+#define LMS_SHARED_CATALOG_H
+
+#include <cerrno>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "library.h"
+
+// ==================== Shared Catalog ====================>
+
+// A catalog shared by several lms processes on one host through a memory-mapped region file.
+//
+// The region holds the catalog as Book::toString lines taken at some sequence number, followed by
+// a log of the mutations committed since, all under a robust process-shared mutex. Each process
+// keeps its own Library and indexes as a cache of the region: every catalog operation takes the
+// mutex, applies the mutations other processes logged since its last operation, runs, and logs its
+// own. When the log fills, the process that filled it writes its catalog as the new snapshot.
+//
+// Region state is double-buffered and switched with one store, so a process that dies holding the
+// mutex leaves the last committed state behind. The catalog file is read when the first process
+// attaches (or, after a crash, rewritten from the region), and written when a process detaches;
+// operations never rewrite it. Loan handles are local to the process that issued them.
+//
+// Holds are turned off: hold queues live in each process, so a copy returned in another process
+// would never reach the patrons waiting in this one.
+class SharedCatalog {
+    static constexpr uint64_t MAGIC = 0x4c4d5353484d3031; // "LMSSHM01"
+    static constexpr uint64_t HEADER_BYTES = 4096;
+    static constexpr uint64_t LOG_BYTES = 4 << 20;
+    static constexpr uint64_t MIN_SLOT_BYTES = 1 << 20;
+    static constexpr uint64_t FIRST_SLOT = HEADER_BYTES + LOG_BYTES;
+
+    // Layout: header, mutation log, then two snapshot slots; the snapshot alternates between them
+    struct State {
+        uint64_t region_bytes;
+        uint64_t slot_bytes;
+        uint64_t snapshot_offset;
+        uint64_t snapshot_bytes;
+        uint64_t snapshot_seq;
+        uint64_t log_bytes;
+        uint64_t head_seq;  // sequence number of the last logged mutation, or of the snapshot
+        uint64_t epoch;     // bumped whenever the log is emptied
+        uint64_t saved_seq; // sequence number last written to the catalog file
+    };
+
+    struct Header {
+        uint64_t magic;
+        pthread_mutex_t mutex;
+        uint32_t current;
+        State states[2];
+    };
+
+    Library &library;
+    string catalog_file;
+    int fd = -1;
+    Header *header = nullptr; // mapped on its own so the mutex never moves
+    char *region = nullptr;
+    uint64_t mapped_bytes = 0;
+    bool loaded = false;  // the library holds the region's catalog
+    uint64_t epoch = 0;
+    uint64_t cursor = 0;  // log bytes already applied in `epoch`
+    bool applying = false; // applying other processes' mutations
+
+    const State &state() const { return header->states[header->current]; }
+
+    // Publish a complete state with one store
+    void commit(const State &next) {
+        header->states[1 - header->current] = next;
+        __atomic_store_n(&header->current, 1 - header->current, __ATOMIC_RELEASE);
+    }
+
+    bool lockRange(short type, off_t start, bool wait) {
+        struct flock range = {};
+        range.l_type = type;
+        range.l_whence = SEEK_SET;
+        range.l_start = start;
+        range.l_len = 1;
+        return fcntl(fd, wait ? F_SETLKW : F_SETLK, &range) == 0;
+    }
+
+    bool mapRegion(uint64_t bytes) {
+        if (bytes <= mapped_bytes) { return true; }
+        void *mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) { return false; }
+        if (region) { munmap(region, mapped_bytes); }
+        region = static_cast<char *>(mapped);
+        mapped_bytes = bytes;
+        return true;
+    }
+
+    vector<string> snapshotLines(const State &current) const {
+        vector<string> lines;
+        const char *data = region + current.snapshot_offset;
+        for (uint64_t begin = 0; begin < current.snapshot_bytes;) {
+            uint64_t end = begin;
+            while (data[end] != '\n') { ++end; }
+            lines.emplace_back(data + begin, end - begin);
+            begin = end + 1;
+        }
+        return lines;
+    }
+
+    // Bring the library up to the region's last committed mutation
+    void catchUp() {
+        const State &current = state();
+        if (!mapRegion(current.region_bytes)) {
+            cerr << "Error: Unable to map the shared catalog." << endl;
+            return;
+        }
+
+        applying = true;
+        if (!loaded || library.getLastSeq() < current.snapshot_seq) {
+            library.loadSnapshot(snapshotLines(current), current.snapshot_seq);
+            loaded = true;
+            cursor = 0;
+        }
+        if (epoch != current.epoch) {
+            epoch = current.epoch;
+            cursor = 0;
+        }
+        const char *log = region + HEADER_BYTES;
+        while (cursor < current.log_bytes) {
+            const char *eol = static_cast<const char *>(memchr(log + cursor, '\n', current.log_bytes - cursor));
+            Mutation mutation = Mutation::fromString(string(log + cursor, eol));
+            if (mutation.seq > library.getLastSeq()) { library.applyMutation(mutation); }
+            cursor = eol + 1 - log;
+        }
+        applying = false;
+    }
+
+    // Write the library as the region's snapshot and empty the log, growing the region if needed
+    bool writeSnapshot(State next) {
+        string data;
+        for (const auto &line: library.snapshot()) {
+            data += line;
+            data += '\n';
+        }
+
+        uint64_t target = next.snapshot_offset == FIRST_SLOT ? FIRST_SLOT + next.slot_bytes : FIRST_SLOT;
+        if (data.size() > next.slot_bytes) {
+            // Past the end of both old slots, so the committed snapshot stays intact
+            next.slot_bytes = max<uint64_t>({MIN_SLOT_BYTES, next.slot_bytes * 2, data.size() * 2});
+            next.region_bytes = FIRST_SLOT + 2 * next.slot_bytes;
+            target = FIRST_SLOT + next.slot_bytes;
+            if (ftruncate(fd, off_t(next.region_bytes)) != 0 || !mapRegion(next.region_bytes)) { return false; }
+        }
+
+        memcpy(region + target, data.data(), data.size());
+        next.snapshot_offset = target;
+        next.snapshot_bytes = data.size();
+        next.snapshot_seq = next.head_seq = library.getLastSeq();
+        next.log_bytes = 0;
+        ++next.epoch;
+        commit(next);
+        epoch = next.epoch;
+        cursor = 0;
+        return true;
+    }
+
+    // Log a mutation this process committed; a full log is folded into a new snapshot
+    void append(const Mutation &mutation) {
+        string line = mutation.toString() + "\n";
+        State next = state();
+        if (next.log_bytes + line.size() > LOG_BYTES) {
+            if (!writeSnapshot(next)) {
+                cerr << "Error: Unable to grow the shared catalog; the last change was not shared." << endl;
+                loaded = false; // reload the committed catalog at the next operation
+            }
+            return;
+        }
+
+        memcpy(region + HEADER_BYTES + next.log_bytes, line.data(), line.size());
+        next.log_bytes += line.size();
+        next.head_seq = mutation.seq;
+        commit(next);
+        cursor = next.log_bytes;
+    }
+
+    // Start the region over from the library; only while no other process is attached
+    bool initialize(uint64_t saved_seq) {
+        if (ftruncate(fd, off_t(FIRST_SLOT)) != 0 || !mapRegion(FIRST_SLOT)) { return false; }
+        header->magic = 0;
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+
+        header->current = 0;
+        header->states[0] = {FIRST_SLOT, 0, FIRST_SLOT, 0, 0, 0, 0, epoch, saved_seq};
+        if (!writeSnapshot(header->states[0])) { return false; }
+        header->magic = MAGIC;
+        return true;
+    }
+
+    // Load the catalog file; a missing file is an empty catalog
+    void loadCatalogFile() {
+        vector<string> lines;
+        ifstream inFile(catalog_file, ios::binary);
+        string line;
+        while (getline(inFile, line)) {
+            if (!line.empty()) { lines.push_back(line); }
+        }
+        library.loadSnapshot(lines, 0);
+    }
+
+    // Write the catalog file if mutations were committed since it was last written
+    void saveCatalogFile() {
+        State next = state();
+        if (next.saved_seq == next.head_seq) { return; }
+        if (!library.saveBooksToFile(catalog_file)) {
+            cerr << "Error: Unable to open file for writing." << endl;
+            return;
+        }
+        next.saved_seq = next.head_seq;
+        commit(next);
+    }
+
+public:
+    // Attach the library to the region file, creating it from the catalog file when no other
+    // process is attached. Byte 0 of the region file is read-locked by every attached process;
+    // byte 1 serializes attaching.
+    SharedCatalog(Library &library, const string &region_path, string catalog_file = "library_books.csv")
+        : library(library), catalog_file(std::move(catalog_file)) {
+        fd = open(region_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st;
+        if (fd < 0 || !lockRange(F_WRLCK, 1, true) || fstat(fd, &st) != 0 ||
+            (uint64_t(st.st_size) < HEADER_BYTES && ftruncate(fd, off_t(HEADER_BYTES)) != 0)) {
+            cerr << "Error: Unable to open the shared catalog " << region_path << "." << endl;
+            return;
+        }
+        void *mapped = mmap(nullptr, HEADER_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            cerr << "Error: Unable to map the shared catalog " << region_path << "." << endl;
+            return;
+        }
+        header = static_cast<Header *>(mapped);
+
+        bool ok;
+        if (lockRange(F_WRLCK, 0, false)) {
+            // First to attach: recover mutations a crashed session never wrote to the catalog file,
+            // else start from the file, which may have been edited since
+            if (header->magic == MAGIC && state().head_seq != state().saved_seq) {
+                catchUp();
+                library.saveBooksToFile(this->catalog_file);
+            } else {
+                loadCatalogFile();
+            }
+            loaded = true;
+            epoch = 0;
+            ok = initialize(library.getLastSeq());
+            ok = lockRange(F_RDLCK, 0, false) && ok;
+        } else {
+            ok = header->magic == MAGIC && lockRange(F_RDLCK, 0, false);
+            if (ok) {
+                lock();
+                unlock();
+            }
+        }
+        lockRange(F_UNLCK, 1, false);
+        if (!ok) {
+            cerr << "Error: Unable to attach to the shared catalog " << region_path << "." << endl;
+            return;
+        }
+
+        library.setCatalogLock([this] { lock(); }, [this] { unlock(); });
+        library.disableHolds();
+        library.addMutationListener([this](const Mutation &mutation) {
+            if (!applying) { append(mutation); }
+        });
+    }
+
+    ~SharedCatalog() {
+        if (isAttached()) {
+            lock();
+            saveCatalogFile();
+            unlock();
+        }
+        library.setCatalogLock(nullptr, nullptr);
+        if (region) { munmap(region, mapped_bytes); }
+        if (header) { munmap(header, HEADER_BYTES); }
+        if (fd >= 0) { close(fd); }
+    }
+
+    bool isAttached() const { return region != nullptr; }
+
+    // Take the region mutex and apply other processes' mutations
+    void lock() {
+        if (pthread_mutex_lock(&header->mutex) == EOWNERDEAD) {
+            // The owner died; every state it committed is complete
+            pthread_mutex_consistent(&header->mutex);
+        }
+        catchUp();
+    }
+
+    void unlock() { pthread_mutex_unlock(&header->mutex); }
+
+    // Whether the mutation being delivered to listeners was committed by another process
+    bool isApplyingRemote() const { return applying; }
+};
+
+#endif //LMS_SHARED_CATALOG_H
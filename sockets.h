@@ -0,0 +1,59 @@
+#ifndef LMS_SOCKETS_H
+#define LMS_SOCKETS_H
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "library.h"
+
+// ==================== Socket Helpers ====================>
+
+// Write the whole buffer to a socket
+inline bool sendAll(int fd, const string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) { return false; }
+        sent += n;
+    }
+    return true;
+}
+
+// Buffered reader of newline terminated lines from a socket
+class LineReader {
+    int fd;
+    string buffer;
+    size_t pos = 0;
+
+public:
+    explicit LineReader(int fd) { this->fd = fd; }
+
+    bool readLine(string &line) {
+        while (true) {
+            size_t end = buffer.find('\n', pos);
+            if (end != string::npos) {
+                line.assign(buffer, pos, end - pos);
+                pos = end + 1;
+                return true;
+            }
+
+            buffer.erase(0, pos);
+            pos = 0;
+
+            char chunk[64 * 1024];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) { return false; }
+            buffer.append(chunk, n);
+        }
+    }
+};
+
+// Create a Unix socket address for the given path
+inline sockaddr_un unixAddress(const string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+#endif //LMS_SOCKETS_H
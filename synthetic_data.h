@@ -0,0 +1,110 @@
+#ifndef LMS_SYNTHETIC_DATA_H
+#define LMS_SYNTHETIC_DATA_H
+
+#include <random>
+
+#include "library.h"
+
+// ==================== Synthetic Data ====================>
+
+// Parameters of a synthetic library
+struct SyntheticConfig {
+    size_t titles = 1000;
+    int max_copies = 10;          // each title gets 1..max_copies copies
+    size_t borrowers = 10000;     // size of the patron pool
+    double loan_ratio = 0.3;      // fraction of copies on loan
+    double overdue_ratio = 0.1;   // fraction of loans past their return date
+    uint64_t seed = 42;
+    time_t now = 1735689600;      // reference time for loan dates (01-01-2025), fixed for reproducible output
+};
+
+// Deterministic generator of catalogs and loan histories. Only raw mt19937_64 output is used
+// (no std distributions, whose results differ between standard libraries), so a seed yields the
+// same data on every platform.
+class SyntheticLibrary {
+    static constexpr time_t DAY = 24 * 60 * 60;
+    static constexpr time_t LOAN_PERIOD = 15 * DAY;
+
+    SyntheticConfig config;
+    mt19937_64 rng;
+
+    uint64_t below(uint64_t n) { return rng() % n; }
+
+    double unit() { return double(rng() >> 11) / double(1ULL << 53); }
+
+public:
+    explicit SyntheticLibrary(SyntheticConfig config) : config(config), rng(config.seed) {}
+
+    // ISBN of the title with the given index
+    static string isbnOf(size_t index) {
+        string digits = to_string(index);
+        return "978" + string(digits.size() < 10 ? 10 - digits.size() : 0, '0') + digits;
+    }
+
+    static Borrower patronOf(size_t id, time_t borrow_date, time_t return_date) {
+        string digits = to_string(id);
+        return Borrower("Patron " + digits, "9" + string(digits.size() < 9 ? 9 - digits.size() : 0, '0') + digits,
+                        "patron" + digits + "@example.org", borrow_date, return_date);
+    }
+
+    // Patron identity as name|mobile|email, as used by the loan ledger
+    static string patronKey(size_t id) {
+        Borrower patron = patronOf(id, 0, 0);
+        return patron.getName() + "|" + patron.getMobile() + "|" + patron.getEmail();
+    }
+
+    Book generateBook(size_t index) {
+        int copies = 1 + int(below(config.max_copies));
+        vector<Borrower> borrowers;
+        for (int copy = 0; copy < copies; ++copy) {
+            if (unit() >= config.loan_ratio) { continue; }
+
+            time_t borrow_date, return_date;
+            if (unit() < config.overdue_ratio) {
+                return_date = config.now - time_t(1 + below(30)) * DAY;
+                borrow_date = return_date - LOAN_PERIOD;
+            } else {
+                borrow_date = config.now - time_t(below(15)) * DAY;
+                return_date = borrow_date + LOAN_PERIOD;
+            }
+            borrowers.push_back(patronOf(below(config.borrowers), borrow_date, return_date));
+        }
+
+        return Book("Title " + to_string(index), "Author " + to_string(below(config.titles / 10 + 1)),
+                    isbnOf(index), copies, borrowers);
+    }
+
+    vector<Book> generateCatalog() {
+        vector<Book> books;
+        books.reserve(config.titles);
+        for (size_t i = 0; i < config.titles; ++i) {
+            books.push_back(generateBook(i));
+        }
+        return books;
+    }
+
+    // Write a catalog file in the library's own format
+    bool writeCatalog(const string &path) {
+        ofstream outFile(path);
+        if (!outFile) { return false; }
+
+        for (size_t i = 0; i < config.titles; ++i) {
+            outFile << generateBook(i).toString() << '\n';
+        }
+        return bool(outFile);
+    }
+
+    // Borrow history as (patron key, ISBN) pairs; squaring a uniform draw skews popularity to low indexes
+    vector<pair<string, string>> generateLoanHistory(size_t events) {
+        vector<pair<string, string>> borrows;
+        borrows.reserve(events);
+        for (size_t i = 0; i < events; ++i) {
+            double u = unit();
+            size_t patron = below(config.borrowers);
+            borrows.emplace_back(patronKey(patron), isbnOf(size_t(u * u * config.titles)));
+        }
+        return borrows;
+    }
+};
+
+#endif //LMS_SYNTHETIC_DATA_H
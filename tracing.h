@@ -0,0 +1,95 @@
+#ifndef LMS_TRACING_H
+#define LMS_TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+// ==================== Tracing ====================>
+
+// Collects timed spans and writes them as Chrome Trace Event JSON (chrome://tracing, Perfetto).
+// Disabled by default; a disabled span costs one relaxed atomic load.
+class Tracer {
+    struct Span {
+        const char *name;
+        int64_t start_us;
+        int64_t duration_us;
+        uint32_t thread;
+    };
+
+    atomic<bool> enabled{false};
+    mutex spans_mutex;
+    vector<Span> spans;
+    string path;
+    chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    atomic<uint32_t> next_thread{1};
+
+    static uint32_t threadNumber() {
+        thread_local uint32_t number = instance().next_thread++;
+        return number;
+    }
+
+public:
+    static Tracer &instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Start collecting spans; they are written to path when the process exits
+    void enable(const string &trace_path) {
+        path = trace_path;
+        enabled = true;
+        atexit([] { instance().write(); });
+    }
+
+    bool isEnabled() const { return enabled.load(memory_order_relaxed); }
+
+    void record(const char *name, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end) {
+        Span span{name, chrono::duration_cast<chrono::microseconds>(start - origin).count(),
+                  chrono::duration_cast<chrono::microseconds>(end - start).count(), threadNumber()};
+        lock_guard<mutex> lock(spans_mutex);
+        spans.push_back(span);
+    }
+
+    // Write the collected spans as complete ("X") events
+    void write() {
+        if (path.empty()) { return; }
+
+        lock_guard<mutex> lock(spans_mutex);
+        ofstream outFile(path);
+        outFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t i = 0; i < spans.size(); ++i) {
+            const Span &span = spans[i];
+            outFile << (i ? ",\n" : "\n") << "{\"name\":\"" << span.name << "\",\"cat\":\"lms\",\"ph\":\"X\",\"ts\":"
+                    << span.start_us << ",\"dur\":" << span.duration_us << ",\"pid\":" << getpid()
+                    << ",\"tid\":" << span.thread << "}";
+        }
+        outFile << "\n]}\n";
+    }
+};
+
+// Traces the lifetime of a scope when tracing is enabled
+class TraceSpan {
+    const char *name;
+    chrono::steady_clock::time_point start;
+    bool active;
+
+public:
+    explicit TraceSpan(const char *name) : name(name), active(Tracer::instance().isEnabled()) {
+        if (active) { start = chrono::steady_clock::now(); }
+    }
+
+    ~TraceSpan() {
+        if (active) { Tracer::instance().record(name, start, chrono::steady_clock::now()); }
+    }
+};
+
+#endif //LMS_TRACING_H